@@ -0,0 +1,188 @@
+// Compares serializing a large display config through a toml11 tree (what saves used to do) with the streaming TomlEmitter.
+// Build with -DBUILD_BENCHMARKS=ON and run budgie-desktop-services-bench-configsave [groups] [runs].
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <toml.hpp>
+
+#include "config/emitter.hpp"
+#include "config/outputs/group.hpp"
+#include "config/outputs/output.hpp"
+
+namespace {
+  std::atomic<quint64> allocations {0};
+  std::atomic<quint64> allocated_bytes {0};
+
+  void track(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+}  // namespace
+
+// Counted at the malloc level, so Qt's containers and strings show up next to operator new (which ends up here too). The definitions in
+// the executable take precedence over libc's for every library loaded, and forward to glibc's own implementation.
+extern "C" {
+  void* __libc_malloc(std::size_t size);
+  void* __libc_calloc(std::size_t count, std::size_t size);
+  void* __libc_realloc(void* ptr, std::size_t size);
+  void* __libc_memalign(std::size_t alignment, std::size_t size);
+  void  __libc_free(void* ptr);
+
+  void* malloc(std::size_t size) noexcept {
+    track(size);
+    return __libc_malloc(size);
+  }
+
+  void* calloc(std::size_t count, std::size_t size) noexcept {
+    track(count * size);
+    return __libc_calloc(count, size);
+  }
+
+  void* realloc(void* ptr, std::size_t size) noexcept {
+    // Growing a buffer in place or moving it, either way the caller asked for memory
+    if (size) track(size);
+    return __libc_realloc(ptr, size);
+  }
+
+  // Aligned allocations, operator new for over-aligned types among them. valloc and pvalloc are obsolete and not counted.
+  void* memalign(std::size_t alignment, std::size_t size) noexcept {
+    track(size);
+    return __libc_memalign(alignment, size);
+  }
+
+  void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+    track(size);
+    return __libc_memalign(alignment, size);
+  }
+
+  int posix_memalign(void** ptr, std::size_t alignment, std::size_t size) noexcept {
+    if (alignment % sizeof(void*) != 0 || !std::has_single_bit(alignment)) return EINVAL;
+    track(size);
+    auto memory = __libc_memalign(alignment, size);
+    if (!memory) return ENOMEM;
+    *ptr = memory;
+    return 0;
+  }
+
+  void free(void* ptr) noexcept {
+    __libc_free(ptr);
+  }
+}
+
+namespace {
+  using bd::Config::Outputs::Group;
+  using bd::Config::Outputs::Output;
+
+  QList<QSharedPointer<Group>> makeGroups(int count) {
+    QList<QSharedPointer<Group>> groups;
+    for (int g = 0; g < count; g++) {
+      QStringList identifiers;
+      QList<QSharedPointer<Output>> outputs;
+      for (int o = 0; o < 3; o++) {
+        auto identifier = QString("SERIAL-%1-%2").arg(g).arg(o);
+        auto output     = QSharedPointer<Output>(new Output());
+        output->setIdentifier(identifier);
+        output->setMake("Budgie");
+        output->setModel(QString("Monitor %1").arg(o));
+        output->setConnector(QString("DP-%1").arg(o + 1));
+        output->setWidth(2560);
+        output->setHeight(1440);
+        output->setRefresh(143998);
+        if (o > 0) {
+          output->setRelativeOutput(identifiers.last());
+          output->setHorizontalAnchor(bd::Outputs::Config::HorizontalAnchor::Right);
+          output->setVerticalAnchor(bd::Outputs::Config::VerticalAnchor::Top);
+        }
+        output->setScale(1.25);
+        identifiers << identifier;
+        outputs << output;
+      }
+
+      auto group = QSharedPointer<Group>(new Group());
+      group->setName(identifiers.join(", ").append(" (Auto Generated)"));
+      group->setStoredIdentifiers(identifiers);
+      group->setStoredPrimaryOutputIdentifier(identifiers.first());
+      group->setOutputConfigs(outputs);
+      group->setAutoGenerated(true);
+      group->setUsage(1735689600 + g, g);
+      groups << group;
+    }
+    return groups;
+  }
+
+  // The pre-emitter State::serialize
+  QByteArray serializeTree(const QList<QSharedPointer<Group>>& groups) {
+    toml::ordered_value config(toml::ordered_table {});
+    config.as_table_fmt().fmt = toml::table_format::multiline;
+
+    toml::ordered_value preferences_table(toml::ordered_table {});
+    preferences_table["automatic_attach_outputs_relative_position"] = std::string("right");
+    config["preferences"] = preferences_table;
+
+    toml::ordered_value groups_array(toml::ordered_array {});
+    groups_array.as_array_fmt().fmt = toml::array_format::array_of_tables;
+    for (const auto& group : groups) { groups_array.push_back(group->toToml()); }
+    config.as_table().emplace_back("group", groups_array);
+
+    return QByteArray::fromStdString(toml::format(config));
+  }
+
+  QByteArray serializeStream(const QList<QSharedPointer<Group>>& groups) {
+    QByteArray out;
+    bd::Config::TomlEmitter emitter(out);
+    emitter.table("preferences");
+    emitter.string("automatic_attach_outputs_relative_position", "right");
+    for (const auto& group : groups) { group->writeToml(emitter); }
+    return out;
+  }
+
+  template <typename F>
+  void measure(const char* label, int runs, F&& serialize) {
+    qint64     best_ns = -1;
+    quint64    best_allocations = 0, best_bytes = 0;
+    qsizetype  size = 0;
+    for (int run = 0; run < runs; run++) {
+      auto start_allocations = allocations.load();
+      auto start_bytes       = allocated_bytes.load();
+      QElapsedTimer timer;
+      timer.start();
+      auto out     = serialize();
+      auto elapsed = timer.nsecsElapsed();
+      if (best_ns < 0 || elapsed < best_ns) {
+        best_ns          = elapsed;
+        best_allocations = allocations.load() - start_allocations;
+        best_bytes       = allocated_bytes.load() - start_bytes;
+      }
+      size = out.size();
+    }
+    std::printf("%-8s %10.3f ms %12llu allocations %14llu bytes allocated %10lld bytes out\n", label, best_ns / 1e6,
+                static_cast<unsigned long long>(best_allocations), static_cast<unsigned long long>(best_bytes), static_cast<long long>(size));
+  }
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+  auto             args   = app.arguments();
+  int              count  = args.size() > 1 ? args.at(1).toInt() : 1000;
+  int              runs   = args.size() > 2 ? args.at(2).toInt() : 10;
+  auto             groups = makeGroups(count);
+
+  // Both have to describe the same config
+  auto tree   = toml::parse_str(serializeTree(groups).toStdString());
+  auto stream = toml::parse_str(serializeStream(groups).toStdString());
+  if (toml::find<std::vector<toml::value>>(tree, "group") != toml::find<std::vector<toml::value>>(stream, "group")) {
+    std::fprintf(stderr, "tree and stream output differ\n");
+    return EXIT_FAILURE;
+  }
+
+  std::printf("%d groups, best of %d runs\n", count, runs);
+  measure("tree", runs, [&]() { return serializeTree(groups); });
+  measure("stream", runs, [&]() { return serializeStream(groups); });
+  return EXIT_SUCCESS;
+}
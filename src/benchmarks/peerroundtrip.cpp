@@ -0,0 +1,80 @@
+// Compares Outputs.GetSnapshot round trips through the session bus daemon with the same call over the daemon's peer-to-peer socket in
+// $XDG_RUNTIME_DIR, the two transports PeerServer serves our objects on. Needs a running daemon. Build with -DBUILD_BENCHMARKS=ON and run
+// budgie-desktop-services-bench-peerroundtrip [calls].
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "dbus/PeerServer.hpp"
+
+namespace {
+  constexpr auto Service    = "org.buddiesofbudgie.Services";
+  constexpr auto ObjectPath = "/org/buddiesofbudgie/Services/Outputs";
+  constexpr auto Interface  = "org.buddiesofbudgie.Services.Outputs";
+
+  bool measure(const char* label, QDBusConnection connection, const QString& service, int calls) {
+    auto call = QDBusMessage::createMethodCall(service, ObjectPath, Interface, "GetSnapshot");
+
+    // Warm up, the first calls pay for the daemon building its snapshot and for connection setup
+    for (int i = 0; i < 100; i++) connection.call(call, QDBus::Block);
+
+    QList<qint64> samples;
+    samples.reserve(calls);
+    for (int i = 0; i < calls; i++) {
+      QElapsedTimer timer;
+      timer.start();
+      auto reply = connection.call(call, QDBus::Block);
+      samples.append(timer.nsecsElapsed());
+      if (reply.type() != QDBusMessage::ReplyMessage) {
+        std::fprintf(stderr, "%s: GetSnapshot failed: %s\n", label, qPrintable(reply.errorMessage()));
+        return false;
+      }
+    }
+
+    std::sort(samples.begin(), samples.end());
+    qint64 total = 0;
+    for (auto sample : samples) total += sample;
+    std::printf("%-6s %10.1f us mean %10.1f us p50 %10.1f us p99\n", label, total / 1e3 / calls, samples.at(calls / 2) / 1e3,
+                samples.at(std::min<qsizetype>(calls - 1, calls * 99 / 100)) / 1e3);
+    return true;
+  }
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+  auto             args  = app.arguments();
+  int              calls = args.size() > 1 ? args.at(1).toInt() : 10000;
+  if (calls <= 0) calls = 10000;
+
+  std::printf("%d GetSnapshot calls per transport\n", calls);
+  bool ok = true;
+
+  auto bus = QDBusConnection::sessionBus();
+  if (bus.isConnected()) {
+    ok &= measure("bus", bus, Service, calls);
+  } else {
+    std::fprintf(stderr, "bus    skipped, no session bus\n");
+    ok = false;
+  }
+
+  auto runtimeDir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+  auto address    = QString("unix:path=%1").arg(QDir(runtimeDir).filePath(PEER_SERVER_SOCKET_NAME));
+  auto peer       = QDBusConnection::connectToPeer(address, "bench-peer");
+  if (peer.isConnected()) {
+    // Peer connections have no bus daemon to route by name
+    ok &= measure("peer", peer, QString(), calls);
+  } else {
+    std::fprintf(stderr, "peer   skipped, cannot connect to %s: %s\n", qPrintable(address), qPrintable(peer.lastError().message()));
+    ok = false;
+  }
+  QDBusConnection::disconnectFromPeer("bench-peer");
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,113 @@
+#include "emitter.hpp"
+
+#include <QLocale>
+#include <cmath>
+
+namespace bd::Config {
+  TomlEmitter::TomlEmitter(QByteArray& out) : m_out(out) {}
+
+  void TomlEmitter::table(std::string_view name) {
+    header("[", name, "]");
+  }
+
+  void TomlEmitter::arrayTable(std::string_view name) {
+    header("[[", name, "]]");
+  }
+
+  void TomlEmitter::string(std::string_view key, const QString& value) {
+    this->key(key);
+    quoted(value);
+    m_out.append('\n');
+  }
+
+  void TomlEmitter::boolean(std::string_view key, bool value) {
+    this->key(key);
+    m_out.append(value ? "true\n" : "false\n");
+  }
+
+  void TomlEmitter::integer(std::string_view key, qint64 value) {
+    this->key(key);
+    m_out.append(QByteArray::number(value));
+    m_out.append('\n');
+  }
+
+  void TomlEmitter::floating(std::string_view key, double value) {
+    this->key(key);
+    if (std::isnan(value)) {
+      m_out.append("nan\n");
+      return;
+    }
+    if (std::isinf(value)) {
+      m_out.append(value < 0 ? "-inf\n" : "inf\n");
+      return;
+    }
+
+    // Shortest representation that reads back to the same double, TOML wants a fraction or exponent on floats
+    auto number = QByteArray::number(value, 'g', QLocale::FloatingPointShortest);
+    m_out.append(number);
+    if (!number.contains('.') && !number.contains('e')) m_out.append(".0");
+    m_out.append('\n');
+  }
+
+  void TomlEmitter::stringArray(std::string_view key, const QStringList& values) {
+    this->key(key);
+    m_out.append('[');
+    for (qsizetype i = 0; i < values.size(); i++) {
+      if (i > 0) m_out.append(", ");
+      quoted(values.at(i));
+    }
+    m_out.append("]\n");
+  }
+
+  void TomlEmitter::header(std::string_view open, std::string_view name, std::string_view close) {
+    // Separate tables the way a person would
+    if (!m_out.isEmpty()) m_out.append('\n');
+    m_out.append(open.data(), open.size());
+    m_out.append(name.data(), name.size());
+    m_out.append(close.data(), close.size());
+    m_out.append('\n');
+  }
+
+  void TomlEmitter::key(std::string_view key) {
+    m_out.append(key.data(), key.size());
+    m_out.append(" = ");
+  }
+
+  void TomlEmitter::quoted(const QString& value) {
+    m_out.append('"');
+    for (auto c : value.toUtf8()) {
+      switch (c) {
+        case '"':
+          m_out.append("\\\"");
+          break;
+        case '\\':
+          m_out.append("\\\\");
+          break;
+        case '\b':
+          m_out.append("\\b");
+          break;
+        case '\t':
+          m_out.append("\\t");
+          break;
+        case '\n':
+          m_out.append("\\n");
+          break;
+        case '\f':
+          m_out.append("\\f");
+          break;
+        case '\r':
+          m_out.append("\\r");
+          break;
+        default:
+          // Remaining control characters have no short escape
+          if ((c >= 0 && c < 0x20) || c == 0x7f) {
+            m_out.append(QByteArrayLiteral("\\u00") + QByteArray::number(static_cast<int>(c), 16).rightJustified(2, '0'));
+          } else {
+            m_out.append(c);
+          }
+          break;
+      }
+    }
+    m_out.append('"');
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <string_view>
+
+namespace bd::Config {
+  // Writes TOML straight into a byte buffer, for documents we generate ourselves. Nothing is buffered or reordered: tables and
+  // keys end up in the order they are emitted, so callers write every key of a table before opening the next one.
+  class TomlEmitter {
+    public:
+      explicit TomlEmitter(QByteArray& out);
+
+      // [name] and [[name]]. Dotted names are written as given, e.g. "group.output".
+      void table(std::string_view name);
+      void arrayTable(std::string_view name);
+
+      // Key names must be bare keys (A-Za-z0-9_-)
+      void string(std::string_view key, const QString& value);
+      void boolean(std::string_view key, bool value);
+      void integer(std::string_view key, qint64 value);
+      void floating(std::string_view key, double value);
+      void stringArray(std::string_view key, const QStringList& values);
+
+    private:
+      void header(std::string_view open, std::string_view name, std::string_view close);
+      void key(std::string_view key);
+      void quoted(const QString& value);
+
+      QByteArray& m_out;
+  };
+}
@@ -0,0 +1,175 @@
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QIODevice>
+
+#include "cache.hpp"
+#include "config/utils.hpp"
+#include "sys/SysInfo.hpp"
+
+namespace bd::Config::Outputs {
+    namespace {
+        constexpr quint32 Magic = 0x42444343; // "BDCC"
+        // Anything beyond this is not a cache we wrote
+        constexpr quint32 MaxEntries = 1 << 16;
+
+        void writeOutput(QDataStream& out, const QSharedPointer<Output>& output) {
+            out << output->identifier() << output->make() << output->model() << output->connector();
+            out << qint32(output->width()) << qint32(output->height()) << quint64(output->refresh());
+            out << qint32(output->x()) << qint32(output->y());
+            out << output->relativeOutput() << qint32(output->horizontalAnchor()) << qint32(output->verticalAnchor());
+            out << quint16(output->transform()) << quint32(output->adaptiveSync()) << double(output->scale());
+            out << output->primary() << output->disabled();
+        }
+
+        QSharedPointer<Output> readOutput(QDataStream& in) {
+            QString identifier, make, model, connector, relative_output;
+            qint32 width, height, x, y, horizontal_anchor, vertical_anchor;
+            quint64 refresh;
+            quint16 transform;
+            quint32 adaptive_sync;
+            double scale;
+            bool primary, disabled;
+
+            in >> identifier >> make >> model >> connector;
+            in >> width >> height >> refresh;
+            in >> x >> y;
+            in >> relative_output >> horizontal_anchor >> vertical_anchor;
+            in >> transform >> adaptive_sync >> scale;
+            in >> primary >> disabled;
+            if (in.status() != QDataStream::Ok) return QSharedPointer<Output>(nullptr);
+
+            auto output = QSharedPointer<Output>(new Output());
+            output->setIdentifier(identifier);
+            output->setMake(make);
+            output->setModel(model);
+            output->setConnector(connector);
+            output->setWidth(width);
+            output->setHeight(height);
+            output->setRefresh(refresh);
+            output->setX(x);
+            output->setY(y);
+            output->setRelativeOutput(relative_output);
+            output->setHorizontalAnchor(static_cast<bd::Outputs::Config::HorizontalAnchor::Type>(horizontal_anchor));
+            output->setVerticalAnchor(static_cast<bd::Outputs::Config::VerticalAnchor::Type>(vertical_anchor));
+            output->setTransform(transform);
+            output->setAdaptiveSync(adaptive_sync);
+            output->setScale(scale);
+            output->setPrimary(primary);
+            output->setDisabled(disabled);
+            return output;
+        }
+    }
+
+    QString Cache::path() {
+        bool isShimMode = SysInfo::instance().isShimMode();
+        return QString::fromStdString(ConfigUtils::getCachePath(isShimMode ? "display-config-shim.cache" : "display-config.cache").string());
+    }
+
+    bool Cache::load(const QByteArray& toml, qint64 mtime, QList<QSharedPointer<Group>>& groups, GlobalPreferences& preferences) {
+        auto file = QFile(path());
+        if (!file.open(QIODevice::ReadOnly)) return false;
+
+        // Map rather than read, the cache is only ever looked at once per start
+        auto size = file.size();
+        auto data = file.map(0, size);
+        if (!data) return false;
+
+        auto bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(data), size);
+        QDataStream in(bytes);
+        in.setVersion(QDataStream::Qt_6_0);
+
+        quint32 magic, version;
+        qint64 source_mtime, source_size;
+        QByteArray source_hash;
+        in >> magic >> version >> source_mtime >> source_size;
+        if (in.status() != QDataStream::Ok || magic != Magic || version != Version) {
+            qDebug() << "Display config cache is from a different version, ignoring it";
+            file.unmap(data);
+            return false;
+        }
+
+        // Cheap checks first, the hash settles it
+        if (source_mtime != mtime || source_size != toml.size()) {
+            file.unmap(data);
+            return false;
+        }
+        in >> source_hash;
+        if (source_hash != QCryptographicHash::hash(toml, QCryptographicHash::Sha256)) {
+            file.unmap(data);
+            return false;
+        }
+
+        qint32 position, max_groups, max_age_days;
+        quint32 group_count;
+        in >> position >> max_groups >> max_age_days >> group_count;
+
+        QList<QSharedPointer<Group>> loaded;
+        bool ok = in.status() == QDataStream::Ok && group_count <= MaxEntries;
+        for (quint32 g = 0; ok && g < group_count; g++) {
+            QString name, primary_output;
+            QStringList identifiers;
+            bool preferred, auto_generated;
+            qint64 last_used;
+            quint64 use_count;
+            quint32 output_count;
+            in >> name >> preferred >> auto_generated >> last_used >> use_count >> identifiers >> primary_output >> output_count;
+            if (in.status() != QDataStream::Ok || output_count > MaxEntries) {
+                ok = false;
+                break;
+            }
+
+            QList<QSharedPointer<Output>> outputs;
+            for (quint32 o = 0; o < output_count; o++) {
+                auto output = readOutput(in);
+                if (!output) {
+                    ok = false;
+                    break;
+                }
+                outputs.append(output);
+            }
+
+            auto group = QSharedPointer<Group>(new Group());
+            group->setName(name);
+            group->setPreferred(preferred);
+            group->setAutoGenerated(auto_generated);
+            group->setUsage(last_used, use_count);
+            group->setStoredIdentifiers(identifiers);
+            group->setStoredPrimaryOutputIdentifier(primary_output);
+            group->setOutputConfigs(outputs);
+            loaded.append(group);
+        }
+        file.unmap(data);
+
+        if (!ok) {
+            qWarning() << "Display config cache is corrupt, ignoring it";
+            return false;
+        }
+
+        preferences.setAutomaticAttachOutputsRelativePosition(static_cast<GlobalPreferences::DisplayRelativePosition>(position));
+        preferences.setMaxAutoGeneratedGroups(max_groups);
+        preferences.setAutoGeneratedGroupMaxAgeDays(max_age_days);
+        groups.append(loaded);
+        return true;
+    }
+
+    QByteArray Cache::encode(const QByteArray& toml, qint64 mtime, const QList<QSharedPointer<Group>>& groups, const GlobalPreferences& preferences) {
+        QByteArray bytes;
+        QDataStream out(&bytes, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+
+        out << Magic << Version << qint64(mtime) << qint64(toml.size()) << QCryptographicHash::hash(toml, QCryptographicHash::Sha256);
+        out << qint32(preferences.automaticAttachOutputsRelativePosition()) << qint32(preferences.maxAutoGeneratedGroups())
+            << qint32(preferences.autoGeneratedGroupMaxAgeDays());
+
+        out << quint32(groups.size());
+        for (const auto& group : groups) {
+            auto outputs = group->outputConfigs();
+            out << group->name() << group->preferred() << group->autoGenerated() << qint64(group->lastUsed()) << quint64(group->useCount());
+            out << group->storedIdentifiers() << group->storedPrimaryOutputIdentifier() << quint32(outputs.size());
+            for (const auto& output : outputs) writeOutput(out, output);
+        }
+
+        return bytes;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+#include "group.hpp"
+#include "global_preferences.hpp"
+
+namespace bd::Config::Outputs {
+    // Binary copy of the parsed display config, so startup can skip parsing TOML and go straight to matching.
+    // The TOML file stays the source of truth: a cache entry is only used when the file's mtime, size and SHA-256 all match.
+    class Cache {
+    public:
+        // Bump whenever the layout written by encode changes
+        static constexpr quint32 Version = 1;
+
+        static QString path();
+
+        // Fills groups and preferences from the cache if it was built from exactly this TOML content, false otherwise
+        static bool load(const QByteArray& toml, qint64 mtime, QList<QSharedPointer<Group>>& groups, GlobalPreferences& preferences);
+
+        // Builds a cache entry for the given TOML content and the groups and preferences parsed from it
+        static QByteArray encode(const QByteArray& toml, qint64 mtime, const QList<QSharedPointer<Group>>& groups, const GlobalPreferences& preferences);
+    };
+}
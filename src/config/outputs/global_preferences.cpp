@@ -6,6 +6,8 @@ namespace bd::Config::Outputs {
     GlobalPreferences::GlobalPreferences(QObject* parent)
         : QObject(parent)
         , m_automaticAttachOutputsRelativePosition(GlobalPreferences::None)
+        , m_maxAutoGeneratedGroups(32)
+        , m_autoGeneratedGroupMaxAgeDays(180)
     {
     }
 
@@ -14,11 +16,38 @@ namespace bd::Config::Outputs {
         return m_automaticAttachOutputsRelativePosition;
     }
 
+    int GlobalPreferences::maxAutoGeneratedGroups() const
+    {
+        return m_maxAutoGeneratedGroups;
+    }
+
+    int GlobalPreferences::autoGeneratedGroupMaxAgeDays() const
+    {
+        return m_autoGeneratedGroupMaxAgeDays;
+    }
+
     void GlobalPreferences::setAutomaticAttachOutputsRelativePosition(GlobalPreferences::DisplayRelativePosition position)
     {
         m_automaticAttachOutputsRelativePosition = position;
     }
 
+    void GlobalPreferences::setMaxAutoGeneratedGroups(int count)
+    {
+        m_maxAutoGeneratedGroups = qMax(0, count);
+    }
+
+    void GlobalPreferences::setAutoGeneratedGroupMaxAgeDays(int days)
+    {
+        m_autoGeneratedGroupMaxAgeDays = qMax(0, days);
+    }
+
+    void GlobalPreferences::assign(const GlobalPreferences& other)
+    {
+        m_automaticAttachOutputsRelativePosition = other.m_automaticAttachOutputsRelativePosition;
+        m_maxAutoGeneratedGroups = other.m_maxAutoGeneratedGroups;
+        m_autoGeneratedGroupMaxAgeDays = other.m_autoGeneratedGroupMaxAgeDays;
+    }
+
     QString GlobalPreferences::toString(GlobalPreferences::DisplayRelativePosition value)
     {
         switch (value) {
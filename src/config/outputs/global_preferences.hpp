@@ -21,15 +21,26 @@ namespace bd::Config::Outputs {
         Q_PROPERTY(DisplayRelativePosition automaticAttachOutputsRelativePosition 
                    READ automaticAttachOutputsRelativePosition 
                    WRITE setAutomaticAttachOutputsRelativePosition)
+        Q_PROPERTY(int maxAutoGeneratedGroups READ maxAutoGeneratedGroups WRITE setMaxAutoGeneratedGroups)
+        Q_PROPERTY(int autoGeneratedGroupMaxAgeDays READ autoGeneratedGroupMaxAgeDays WRITE setAutoGeneratedGroupMaxAgeDays)
 
         explicit GlobalPreferences(QObject* parent = nullptr);
         ~GlobalPreferences() = default;
 
-        // Property getter
+        // Property getters
         DisplayRelativePosition automaticAttachOutputsRelativePosition() const;
+        // Auto generated groups kept around, least recently used ones go first. 0 keeps all of them.
+        int maxAutoGeneratedGroups() const;
+        // Auto generated groups not used for this many days are dropped. 0 keeps them regardless of age.
+        int autoGeneratedGroupMaxAgeDays() const;
 
-        // Property setter
+        // Property setters
         void setAutomaticAttachOutputsRelativePosition(DisplayRelativePosition position);
+        void setMaxAutoGeneratedGroups(int count);
+        void setAutoGeneratedGroupMaxAgeDays(int days);
+
+        // Copy all preferences over from another instance
+        void assign(const GlobalPreferences& other);
 
         // Convert enum to string (lowercase for compatibility with config files)
         static QString toString(DisplayRelativePosition value);
@@ -45,6 +56,8 @@ namespace bd::Config::Outputs {
 
     private:
         DisplayRelativePosition m_automaticAttachOutputsRelativePosition;
+        int m_maxAutoGeneratedGroups;
+        int m_autoGeneratedGroupMaxAgeDays;
     };
 }
 
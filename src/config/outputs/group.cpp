@@ -1,3 +1,7 @@
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <stdexcept>
+
 #include "group.hpp"
 #include "outputs/config/model.hpp"
 #include "outputs/state.hpp"
@@ -7,25 +11,59 @@ namespace bd::Config::Outputs {
     Group::Group(QObject* parent) : QObject(parent),
     m_name(""),
     m_stored_primary_output_identifier(""),
-    m_preferred(false) {}
+    m_preferred(false),
+    m_auto_generated(false),
+    m_last_used(0),
+    m_use_count(0) {}
 
-    Group::Group(const toml::value& v, QObject* parent) : QObject(parent) {
+    Group::Group(const toml::value& v, const QString& location, QList<bd::Outputs::ConfigDiagnostic>& diagnostics, QObject* parent) : QObject(parent) {
         m_name               = QString::fromStdString(toml::find<std::string>(v, "name"));
         QList<QString> output_identifiers;
+        if (v.contains("identifiers") && !v.at("identifiers").is_array()) throw std::runtime_error("identifiers is not an array");
         for (const auto& serial : toml::find_or<std::vector<std::string>>(v, "identifiers", {})) { output_identifiers.append(QString::fromStdString(serial)); }
+        if (output_identifiers.isEmpty()) diagnostics.append({"warning", location, "Group has no identifiers and will never match"});
 
         // Toplevel values
         m_stored_identifiers = output_identifiers;
         m_stored_primary_output_identifier = QString::fromStdString(toml::find<std::string>(v, "primary_output"));
         m_preferred          = toml::find_or<bool>(v, "preferred", false);
+        // Configs written before auto_generated existed only mark it in the name
+        m_auto_generated     = toml::find_or<bool>(v, "auto_generated", m_name.endsWith(QStringLiteral(" (Auto Generated)")));
+        m_last_used          = toml::find_or<std::int64_t>(v, "last_used", 0);
+        m_use_count          = static_cast<quint64>(qMax<std::int64_t>(0, toml::find_or<std::int64_t>(v, "use_count", 0)));
+
+        if (!output_identifiers.contains(m_stored_primary_output_identifier)) {
+            diagnostics.append({"warning", location, QString("primary_output %1 is not one of the group's identifiers").arg(m_stored_primary_output_identifier)});
+        }
 
-        // Iterate over the outputs and create the output configs
+        // Iterate over the outputs and create the output configs, a bad output only costs us that output
         auto outputs = toml::find_or<std::vector<toml::value>>(v, "output", {});
-        if (outputs.empty()) return;
+        for (qsizetype i = 0; i < static_cast<qsizetype>(outputs.size()); i++) {
+            auto output_location = QString("%1.output[%2]").arg(location).arg(i);
+            QSharedPointer<Output> output_config;
+            try {
+                output_config = QSharedPointer<Output>(new Output(outputs.at(i)));
+            } catch (const std::exception& e) {
+                diagnostics.append({"error", output_location, QString("Skipped: %1").arg(QString::fromUtf8(e.what()).section('\n', 0, 0).trimmed())});
+                continue;
+            }
+
+            if (!output_identifiers.contains(output_config->identifier())) {
+                diagnostics.append({"warning", output_location, QString("Output %1 is not one of the group's identifiers").arg(output_config->identifier())});
+            }
+            if (!(output_config->scale() > 0)) {
+                diagnostics.append({"warning", output_location, QString("Invalid scale %1, using 1.0").arg(output_config->scale())});
+                output_config->setScale(1.0);
+            }
+            if (output_config->transform() > 7) {
+                diagnostics.append({"warning", output_location, QString("Invalid rotation %1, using 0").arg(output_config->transform())});
+                output_config->setTransform(0);
+            }
+            if (!output_config->relativeOutput().isEmpty() && !output_identifiers.contains(output_config->relativeOutput())) {
+                diagnostics.append({"warning", output_location, QString("relative_output %1 is not one of the group's identifiers").arg(output_config->relativeOutput())});
+            }
 
-        for (const toml::value& output : outputs) {
-            auto output_config = new Output(output);
-            m_output_configs.append(QSharedPointer<Output>(output_config));
+            m_output_configs.append(output_config);
         }
     }
 
@@ -39,6 +77,18 @@ namespace bd::Config::Outputs {
         return this->m_preferred;
     }
     
+    bool Group::autoGenerated() const {
+        return this->m_auto_generated;
+    }
+
+    qint64 Group::lastUsed() const {
+        return this->m_last_used;
+    }
+
+    quint64 Group::useCount() const {
+        return this->m_use_count;
+    }
+
     QString Group::storedPrimaryOutputIdentifier() const {
         return this->m_stored_primary_output_identifier;
     }
@@ -63,6 +113,11 @@ namespace bd::Config::Outputs {
         emit preferredChanged(preferred);
     }
 
+    void Group::setAutoGenerated(bool autoGenerated) {
+        this->m_auto_generated = autoGenerated;
+        emit autoGeneratedChanged(autoGenerated);
+    }
+
     void Group::setStoredPrimaryOutputIdentifier(const QString& storedPrimaryOutputIdentifier) {
         this->m_stored_primary_output_identifier = storedPrimaryOutputIdentifier;
         emit storedPrimaryOutputIdentifierChanged(storedPrimaryOutputIdentifier);
@@ -80,37 +135,8 @@ namespace bd::Config::Outputs {
 
     // Other methods
 
-    void Group::apply() {
-        if (this->m_output_configs.isEmpty()) {
-            qWarning() << "No output configs to apply for group:" << this->m_name;
-            return;
-        }
-
-        auto &orchestrator = bd::Outputs::State::instance();
-        auto manager = orchestrator.getManager();
-        if (manager.isNull()) {
-            qWarning() << "WaylandOutputManager is not available";
-            return;
-        }
-
-        // Reset the batch system and prepare for new configuration
-        auto& batchSystem = bd::Outputs::Config::Model::instance();
-        batchSystem.reset();
-
-        // Connect to batch system completion signals
-        connect(
-            &batchSystem, &bd::Outputs::Config::Model::configurationApplied, this,
-            [this, &batchSystem](bool success) {
-            if (success) {
-                qDebug() << "Display configuration applied successfully via batch system";
-            } else {
-                qWarning() << "Display configuration failed via batch system";
-            }
-            // Disconnect to avoid duplicate signals on subsequent uses
-            disconnect(&batchSystem, &bd::Outputs::Config::Model::configurationApplied, this, nullptr);
-            },
-            Qt::SingleShotConnection
-        );
+    QList<QSharedPointer<bd::Outputs::Config::Action>> Group::actions() {
+        QList<QSharedPointer<bd::Outputs::Config::Action>> actions;
 
         for (const auto& output : this->m_output_configs) {
             auto identifier = output->identifier();
@@ -119,68 +145,96 @@ namespace bd::Config::Outputs {
             if (output->disabled()) {
                 // Create action to disable this output
                 auto offAction = bd::Outputs::Config::Action::explicitOff(output->identifier());
-                batchSystem.addAction(offAction);
+                actions.append(offAction);
                 qDebug() << "  - Disable output action created";
                 continue; // Skip the rest of the loop for this output
             } else {
                 // Create action to enable this output
                 auto onAction = bd::Outputs::Config::Action::explicitOn(output->identifier());
-                batchSystem.addAction(onAction);
+                actions.append(onAction);
                 qDebug() << "  - Enable output action created";
             }
 
             // Set mode (dimensions and refresh)
             auto modeAction = bd::Outputs::Config::Action::mode(output->identifier(), QSize(output->width(), output->height()), output->refresh());
-            batchSystem.addAction(modeAction);
+            actions.append(modeAction);
             qDebug() << "  - Set mode action created with mode:" << output->width() << "x" << output->height() << "@" << output->refresh() << "Hz";
 
-            // Set anchoring if specified; also update the meta head so defaults propagate
+            // Set anchoring if specified
             if (!SysInfo::instance().isShimMode()) {
                 auto relativeOutput = output->relativeOutput();
                 if (!relativeOutput.isEmpty()) {
                     auto horizontalAnchor = output->horizontalAnchor();
                     auto verticalAnchor   = output->verticalAnchor();
                     auto anchorAction     = bd::Outputs::Config::Action::positionAnchor(output->identifier(), relativeOutput, horizontalAnchor, verticalAnchor);
-                    batchSystem.addAction(anchorAction);
+                    actions.append(anchorAction);
                     qDebug() << "  - Set anchoring relative to:" << relativeOutput << "with horizontal anchor:" << bd::Outputs::Config::HorizontalAnchor::toString(horizontalAnchor) << "and vertical anchor:" << bd::Outputs::Config::VerticalAnchor::toString(verticalAnchor);
-                    // Update meta head anchoring
-                    auto head = manager->getOutputHead(output->identifier());
-                    if (!head.isNull()) {
-                        head->setRelativeOutput(relativeOutput);
-                        head->setHorizontalAnchoring(horizontalAnchor);
-                        head->setVerticalAnchoring(verticalAnchor);
-                    }
                 } else {
-                    // Clear meta head anchoring explicitly
-                    auto head = manager->getOutputHead(identifier);
-                    if (!head.isNull()) {
-                        head->setRelativeOutput("");
-                        head->setHorizontalAnchoring(bd::Outputs::Config::HorizontalAnchor::None);
-                        head->setVerticalAnchoring(bd::Outputs::Config::VerticalAnchor::None);
-                    }
-                    qDebug() << "  - No anchoring set";
+                    // Clear it explicitly, the calculation would otherwise start from whatever anchoring the head has right now
+                    actions.append(bd::Outputs::Config::Action::positionAnchor(identifier, "", bd::Outputs::Config::HorizontalAnchor::None,
+                                                                               bd::Outputs::Config::VerticalAnchor::None));
+                    qDebug() << "  - Anchoring cleared";
                 }
             } else {
                 auto absolutePosition = QPoint(output->x(), output->y());
                 auto absolutePositionAction = bd::Outputs::Config::Action::absolutePosition(identifier, absolutePosition);
-                batchSystem.addAction(absolutePositionAction);
+                actions.append(absolutePositionAction);
                 qDebug() << "  - Set absolute position:" << output->x() << "," << output->y();
             }
 
             // Set scale
             auto scaleAction = bd::Outputs::Config::Action::scale(identifier, output->scale());
-            batchSystem.addAction(scaleAction);
+            actions.append(scaleAction);
             qDebug() << "  - Set scale:" << output->scale();
 
             // Set transform (rotation)
             auto transformAction = bd::Outputs::Config::Action::transform(identifier, output->transform());
-            batchSystem.addAction(transformAction);
+            actions.append(transformAction);
             qDebug() << "  - Set transform:" << output->transform();
 
             // Set adaptive sync
             auto adaptiveSyncAction = bd::Outputs::Config::Action::adaptiveSync(identifier, output->adaptiveSync());
-            batchSystem.addAction(adaptiveSyncAction);
+            actions.append(adaptiveSyncAction);
             qDebug() << "  - Set adaptive sync:" << output->adaptiveSync();
+
+            // Set primary, which also clears it on every other output, rather than relying on the heads' current primary
+            if (identifier == this->m_stored_primary_output_identifier) {
+                actions.append(bd::Outputs::Config::Action::primary(identifier));
+                qDebug() << "  - Set primary";
+            }
+        }
+
+        return actions;
+    }
+
+    void Group::apply(QSharedPointer<bd::Outputs::Config::Result> calculated) {
+        if (this->m_output_configs.isEmpty()) {
+            qWarning() << "No output configs to apply for group:" << this->m_name;
+            return;
+        }
+
+        auto &orchestrator = bd::Outputs::State::instance();
+        auto manager = orchestrator.getManager();
+        if (manager.isNull()) {
+            qWarning() << "WaylandOutputManager is not available";
+            return;
+        }
+
+        // The batch is handed to the batch system as a whole so it cannot interleave with client batches
+        auto& batchSystem = bd::Outputs::Config::Model::instance();
+
+        // Update the meta heads' anchoring so defaults propagate, clearing it where the group has none
+        if (!SysInfo::instance().isShimMode()) {
+            for (const auto& output : this->m_output_configs) {
+                if (output->disabled()) continue;
+                auto head = manager->getOutputHead(output->identifier());
+                if (head.isNull()) continue;
+
+                auto anchored = !output->relativeOutput().isEmpty();
+                head->setRelativeOutput(anchored ? output->relativeOutput() : "");
+                head->setHorizontalAnchoring(anchored ? output->horizontalAnchor() : bd::Outputs::Config::HorizontalAnchor::None);
+                head->setVerticalAnchoring(anchored ? output->verticalAnchor() : bd::Outputs::Config::VerticalAnchor::None);
+            }
         }
 
         // Set primary output if specified
@@ -193,9 +247,33 @@ namespace bd::Config::Outputs {
             }
         }
 
-        // Calculate and apply the configuration
-        // batchSystem.calculate();
-        batchSystem.apply();
+        // Queue the batch; it is applied once any in-flight configuration finishes, calculated first unless a plan was handed in. Other
+        // batches may finish in between, only the outcome of this one is ours to report. The group may be gone by then, keep its name.
+        batchSystem.submit(actions(), calculated, [name = this->m_name](const bd::Outputs::ApplyOutcome& outcome) {
+            if (outcome.success) {
+                qDebug() << "Display configuration of group" << name << "applied successfully via batch system";
+            } else {
+                qWarning() << "Display configuration of group" << name << "failed via batch system";
+            }
+        });
+    }
+
+    void Group::markUsed() {
+        this->m_last_used = QDateTime::currentSecsSinceEpoch();
+        this->m_use_count++;
+        emit usageChanged();
+    }
+
+    void Group::setUsage(qint64 lastUsed, quint64 useCount) {
+        this->m_last_used = lastUsed;
+        this->m_use_count = useCount;
+        emit usageChanged();
+    }
+
+    QByteArray Group::identifierKey(QStringList identifiers) {
+        identifiers.sort();
+        // Identifiers never contain a NUL, so joining on it cannot make two different sets collide
+        return QCryptographicHash::hash(identifiers.join(QChar::Null).toUtf8(), QCryptographicHash::Sha1);
     }
 
     QSharedPointer<Output> Group::getOutputForIdentifier(const QString& identifier) {
@@ -207,7 +285,24 @@ namespace bd::Config::Outputs {
         return QSharedPointer<Output>(nullptr);
     }
 
-    toml::ordered_value Group::toToml() {
+    void Group::writeToml(bd::Config::TomlEmitter& emitter, bool includeUsage) {
+        emitter.arrayTable("group");
+        emitter.string("name", this->m_name);
+        emitter.boolean("preferred", this->m_preferred);
+        emitter.stringArray("identifiers", this->m_stored_identifiers);
+        emitter.string("primary_output", this->m_stored_primary_output_identifier);
+        if (includeUsage) {
+            emitter.boolean("auto_generated", this->m_auto_generated);
+            emitter.integer("last_used", this->m_last_used);
+            emitter.integer("use_count", static_cast<qint64>(this->m_use_count));
+        }
+
+        for (const auto& output : this->m_output_configs) {
+            output->writeToml(emitter);
+        }
+    }
+
+    toml::ordered_value Group::toToml(bool includeUsage) {
         toml::ordered_value group_table(toml::ordered_table {});
         group_table.as_table_fmt().fmt = toml::table_format::multiline;
 
@@ -220,6 +315,11 @@ namespace bd::Config::Outputs {
         group_table["preferred"] = this->m_preferred;
         group_table["identifiers"] = output_identifiers;
         group_table["primary_output"] = this->m_stored_primary_output_identifier.toStdString();
+        if (includeUsage) {
+            group_table["auto_generated"] = this->m_auto_generated;
+            group_table["last_used"] = static_cast<std::int64_t>(this->m_last_used);
+            group_table["use_count"] = static_cast<std::int64_t>(this->m_use_count);
+        }
 
         toml::ordered_value outputs(toml::ordered_array {});
         outputs.as_array_fmt().fmt = toml::array_format::array_of_tables;
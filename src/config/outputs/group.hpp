@@ -1,9 +1,13 @@
 #pragma once
 
 #include <qtmetamacros.h>
+#include <QByteArray>
 #include <QObject>
 #include <QSharedPointer>
 
+#include "outputs/config/action.hpp"
+#include "outputs/config/result.hpp"
+#include "outputs/types.hpp"
 #include "outputs/wlr/metahead.hpp"
 #include "output.hpp"
 
@@ -12,6 +16,10 @@ namespace bd::Config::Outputs {
         Q_OBJECT
         Q_PROPERTY(QString name READ name WRITE setName NOTIFY nameChanged)
         Q_PROPERTY(bool preferred READ preferred WRITE setPreferred NOTIFY preferredChanged)
+        // Usage bookkeeping, used to decide which auto generated groups to drop
+        Q_PROPERTY(bool autoGenerated READ autoGenerated WRITE setAutoGenerated NOTIFY autoGeneratedChanged)
+        Q_PROPERTY(qint64 lastUsed READ lastUsed NOTIFY usageChanged)
+        Q_PROPERTY(quint64 useCount READ useCount NOTIFY usageChanged)
         // Stored identifiers
         Q_PROPERTY(QString storedPrimaryOutputIdentifier READ storedPrimaryOutputIdentifier WRITE setStoredPrimaryOutputIdentifier NOTIFY storedPrimaryOutputIdentifierChanged)
         Q_PROPERTY(QList<QString> storedIdentifiers READ storedIdentifiers WRITE setStoredIdentifiers NOTIFY storedIdentifiersChanged)
@@ -24,10 +32,13 @@ namespace bd::Config::Outputs {
         void storedIdentifiersChanged(const QStringList& storedIdentifiers);
         void outputConfigsChanged(const QList<QSharedPointer<Output>>& outputConfigs);
         void preferredChanged(bool preferred);
+        void autoGeneratedChanged(bool autoGenerated);
+        void usageChanged();
 
     public:
         Group(QObject* parent = nullptr);
-        Group(const toml::value& v, QObject* parent = nullptr);
+        // Throws if the group itself can't be read. Outputs that can't be read are skipped and reported in diagnostics instead.
+        Group(const toml::value& v, const QString& location, QList<bd::Outputs::ConfigDiagnostic>& diagnostics, QObject* parent = nullptr);
         ~Group() = default;
 
         // Property getters
@@ -35,11 +46,16 @@ namespace bd::Config::Outputs {
         QString storedPrimaryOutputIdentifier() const;
         QStringList storedIdentifiers() const;
         bool preferred() const;
+        bool autoGenerated() const;
+        // Unix time in seconds, 0 if never used since tracking started
+        qint64 lastUsed() const;
+        quint64 useCount() const;
         QList<QSharedPointer<Output>> outputConfigs() const;
 
         // Property setters
         void setName(const QString& name);
         void setPreferred(bool preferred);
+        void setAutoGenerated(bool autoGenerated);
         void setStoredPrimaryOutputIdentifier(const QString& storedPrimaryOutputIdentifier);
         void setStoredIdentifiers(QStringList storedIdentifiers);
         void setOutputConfigs(const QList<QSharedPointer<Output>>& outputConfigs);
@@ -49,13 +65,29 @@ namespace bd::Config::Outputs {
         void removeMetaHead(QSharedPointer<bd::Outputs::Wlr::MetaHead> metaHead);
         void setPrimaryMetaHead(QSharedPointer<bd::Outputs::Wlr::MetaHead> metaHead);
 
-        void apply();
-        toml::ordered_value toToml();
+        // Applies the group, as is or from a plan previously calculated for it
+        void apply(QSharedPointer<bd::Outputs::Config::Result> calculated = nullptr);
+        // The batch of actions applying this group consists of
+        QList<QSharedPointer<bd::Outputs::Config::Action>> actions();
+        // Records that this group was just applied
+        void markUsed();
+        // Restores usage bookkeeping, e.g. from the startup cache
+        void setUsage(qint64 lastUsed, quint64 useCount);
+        // Usage bookkeeping can be left out, e.g. to compare what a group would configure
+        toml::ordered_value toToml(bool includeUsage = true);
+        // Same content as toToml, written out as a [[group]] table (and its outputs) without building a tree first
+        void writeToml(bd::Config::TomlEmitter& emitter, bool includeUsage = true);
+
+        // Order independent key for a set of output identifiers, groups and head sets with the same outputs share it
+        static QByteArray identifierKey(QStringList identifiers);
     
     private:
         QSharedPointer<Output> getOutputForIdentifier(const QString& identifier);
         QString m_name;
         bool m_preferred;
+        bool m_auto_generated;
+        qint64 m_last_used;
+        quint64 m_use_count;
         QString m_stored_primary_output_identifier;
         QStringList m_stored_identifiers;
         QList<QSharedPointer<Output>> m_output_configs;
@@ -0,0 +1,131 @@
+#include <QDataStream>
+#include <QIODevice>
+#include <QRegularExpression>
+#include <QStringList>
+
+#include "history.hpp"
+#include "config/utils.hpp"
+#include "sys/SysInfo.hpp"
+
+namespace bd::Config::Outputs {
+    namespace {
+        constexpr quint32 Magic = 0x42444348; // "BDCH"
+
+        // Names of the groups in the given chunks, for telling people what an entry changed
+        QStringList groupNames(const QList<QByteArray>& chunks) {
+            static const QRegularExpression name_line(QStringLiteral("^name = \"(.*)\"$"), QRegularExpression::MultilineOption);
+            QStringList names;
+            for (const auto& chunk : chunks) {
+                auto match = name_line.match(QString::fromUtf8(chunk));
+                if (match.hasMatch()) names << match.captured(1);
+            }
+            return names;
+        }
+    }
+
+    QString History::path() {
+        bool isShimMode = SysInfo::instance().isShimMode();
+        return QString::fromStdString(ConfigUtils::getStatePath(isShimMode ? "display-config-shim.history" : "display-config.history").string());
+    }
+
+    QList<QByteArray> History::split(const QByteArray& snapshot) {
+        // Preferences first, then one chunk per [[group]] including its outputs
+        QList<QByteArray> chunks;
+        qsizetype start = 0;
+        qsizetype at = snapshot.startsWith("[[group]]\n") ? 0 : snapshot.indexOf("\n[[group]]\n");
+        while (at >= 0) {
+            auto boundary = snapshot.at(at) == '\n' ? at + 1 : at;
+            if (boundary > start) chunks << snapshot.mid(start, boundary - start);
+            start = boundary;
+            at = snapshot.indexOf("\n[[group]]\n", boundary);
+        }
+        chunks << snapshot.mid(start);
+        return chunks;
+    }
+
+    bool History::record(const QByteArray& snapshot, qint64 savedAt) {
+        if (snapshot == m_head) return false;
+
+        if (!m_head.isEmpty()) {
+            auto previous = split(m_head);
+            auto current = split(snapshot);
+
+            qsizetype prefix = 0;
+            while (prefix < previous.size() && prefix < current.size() && previous.at(prefix) == current.at(prefix)) prefix++;
+            qsizetype suffix = 0;
+            while (suffix < previous.size() - prefix && suffix < current.size() - prefix
+                   && previous.at(previous.size() - 1 - suffix) == current.at(current.size() - 1 - suffix)) {
+                suffix++;
+            }
+
+            auto removed = previous.mid(prefix, previous.size() - prefix - suffix);
+            auto added = current.mid(prefix, current.size() - prefix - suffix);
+            auto names = groupNames(removed) + groupNames(added);
+            names.removeDuplicates();
+
+            m_entries.prepend(Entry {m_head_saved_at, names.isEmpty() ? QStringLiteral("Preferences") : names.join(", "), quint32(prefix), quint32(suffix), removed});
+            while (m_entries.size() > MaxEntries) m_entries.removeLast();
+        }
+
+        m_head = snapshot;
+        m_head_saved_at = savedAt;
+        return true;
+    }
+
+    std::optional<QByteArray> History::snapshot(qsizetype n) const {
+        if (n < 0 || n > m_entries.size() || m_head.isEmpty()) return std::nullopt;
+
+        // Walk back from the newest version one delta at a time
+        auto chunks = split(m_head);
+        for (qsizetype i = 0; i < n; i++) {
+            const auto& entry = m_entries.at(i);
+            if (qsizetype(entry.prefix) + qsizetype(entry.suffix) > chunks.size()) return std::nullopt;
+            chunks = chunks.mid(0, entry.prefix) + entry.chunks + chunks.mid(chunks.size() - entry.suffix);
+        }
+        return chunks.join();
+    }
+
+    QList<History::Entry> History::entries() const {
+        return m_entries;
+    }
+
+    QByteArray History::encode() const {
+        QByteArray bytes;
+        QDataStream out(&bytes, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+
+        out << Magic << Version << m_head << qint64(m_head_saved_at) << quint32(m_entries.size());
+        for (const auto& entry : m_entries) {
+            out << qint64(entry.savedAt) << entry.summary << entry.prefix << entry.suffix << entry.chunks;
+        }
+        return bytes;
+    }
+
+    bool History::decode(const QByteArray& data) {
+        m_head.clear();
+        m_head_saved_at = 0;
+        m_entries.clear();
+
+        QDataStream in(data);
+        in.setVersion(QDataStream::Qt_6_0);
+
+        quint32 magic, version, count;
+        QByteArray head;
+        qint64 head_saved_at;
+        in >> magic >> version >> head >> head_saved_at >> count;
+        if (in.status() != QDataStream::Ok || magic != Magic || version != Version || count > MaxEntries) return false;
+
+        QList<Entry> entries;
+        for (quint32 i = 0; i < count; i++) {
+            Entry entry;
+            in >> entry.savedAt >> entry.summary >> entry.prefix >> entry.suffix >> entry.chunks;
+            if (in.status() != QDataStream::Ok) return false;
+            entries << entry;
+        }
+
+        m_head = head;
+        m_head_saved_at = head_saved_at;
+        m_entries = entries;
+        return true;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <optional>
+
+namespace bd::Config::Outputs {
+    // Bounded ring of earlier versions of the display config. Only the newest version is kept in full, every older one is stored as a
+    // reverse delta against the version after it, at [[group]] granularity, so an entry costs about as much as the groups that changed.
+    class History {
+    public:
+        // Bump whenever the layout written by encode changes
+        static constexpr quint32 Version = 1;
+        static constexpr qsizetype MaxEntries = 50;
+
+        struct Entry {
+            qint64 savedAt;  // Unix time in seconds at which this version became current
+            QString summary; // Groups that differ from the version after it
+            quint32 prefix;  // Leading chunks shared with the version after it
+            quint32 suffix;  // Trailing chunks shared with the version after it
+            QList<QByteArray> chunks; // The chunks in between, as they were in this version
+        };
+
+        static QString path();
+
+        // Restores the ring from encode's output, false (and an empty ring) if it isn't one
+        bool decode(const QByteArray& data);
+        QByteArray encode() const;
+
+        // Makes snapshot the newest version, turning the previous one into an entry. False if it is the same as the newest version.
+        bool record(const QByteArray& snapshot, qint64 savedAt);
+
+        // n = 0 is the newest version, 1 the one before it and so on
+        std::optional<QByteArray> snapshot(qsizetype n) const;
+        // Older versions, newest first; entries().at(n - 1) describes snapshot(n)
+        QList<Entry> entries() const;
+
+    private:
+        static QList<QByteArray> split(const QByteArray& snapshot);
+
+        QByteArray m_head;
+        qint64 m_head_saved_at = 0;
+        QList<Entry> m_entries;
+    };
+}
@@ -5,6 +5,9 @@
 namespace bd::Config::Outputs {
     Output::Output(QObject* parent) : QObject(parent),
     m_identifier(""),
+    m_make(""),
+    m_model(""),
+    m_connector(""),
     m_width(0),
     m_height(0),
     m_refresh(0),
@@ -21,6 +24,9 @@ namespace bd::Config::Outputs {
 
     Output::Output(const toml::value& v, QObject* parent) : QObject(parent) {
         m_identifier = QString::fromStdString(toml::find<std::string>(v, "identifier"));
+        m_make = QString::fromStdString(toml::find_or<std::string>(v, "make", ""));
+        m_model = QString::fromStdString(toml::find_or<std::string>(v, "model", ""));
+        m_connector = QString::fromStdString(toml::find_or<std::string>(v, "connector", ""));
         m_width = toml::find<int>(v, "width");
         m_height = toml::find<int>(v, "height");
         m_refresh = toml::find<qulonglong>(v, "refresh");
@@ -49,6 +55,18 @@ namespace bd::Config::Outputs {
         return this->m_identifier;
     }
 
+    QString Output::make() const {
+        return this->m_make;
+    }
+
+    QString Output::model() const {
+        return this->m_model;
+    }
+
+    QString Output::connector() const {
+        return this->m_connector;
+    }
+
     int Output::width() {
         return this->m_width;
     }
@@ -109,6 +127,21 @@ namespace bd::Config::Outputs {
         emit identifierChanged(identifier);
     }
     
+    void Output::setMake(const QString& make) {
+        this->m_make = make;
+        emit makeChanged(make);
+    }
+
+    void Output::setModel(const QString& model) {
+        this->m_model = model;
+        emit modelChanged(model);
+    }
+
+    void Output::setConnector(const QString& connector) {
+        this->m_connector = connector;
+        emit connectorChanged(connector);
+    }
+
     void Output::setWidth(int width) {
         this->m_width = width;
         emit widthChanged(width);
@@ -181,6 +214,9 @@ namespace bd::Config::Outputs {
         config_table.as_table_fmt().fmt = toml::table_format::multiline;
 
         config_table["identifier"] = this->identifier().toStdString();
+        config_table["make"] = this->make().toStdString();
+        config_table["model"] = this->model().toStdString();
+        config_table["connector"] = this->connector().toStdString();
         config_table["width"] = this->width();
         config_table["height"] = this->height();
         config_table["refresh"] = static_cast<qulonglong>(this->refresh());
@@ -203,13 +239,37 @@ namespace bd::Config::Outputs {
         return config_table;
     }
 
+    void Output::writeToml(bd::Config::TomlEmitter& emitter) {
+        emitter.arrayTable("group.output");
+        emitter.string("identifier", this->identifier());
+        emitter.string("make", this->make());
+        emitter.string("model", this->model());
+        emitter.string("connector", this->connector());
+        emitter.integer("width", this->width());
+        emitter.integer("height", this->height());
+        emitter.integer("refresh", static_cast<qint64>(this->refresh()));
+
+        if (SysInfo::instance().isShimMode()) {
+            emitter.integer("x", this->x());
+            emitter.integer("y", this->y());
+        } else {
+            emitter.string("relative_output", this->relativeOutput());
+            emitter.string("horizontal_anchor", bd::Outputs::Config::HorizontalAnchor::toString(this->horizontalAnchor()));
+            emitter.string("vertical_anchor", bd::Outputs::Config::VerticalAnchor::toString(this->verticalAnchor()));
+        }
+
+        emitter.floating("scale", this->scale());
+        emitter.integer("rotation", this->transform());
+        emitter.integer("adaptive_sync", this->adaptiveSync());
+        emitter.boolean("primary", this->primary());
+        emitter.boolean("disabled", this->disabled());
+    }
+
     void Output::updateFromHead() {
         auto head = getMetaHead();
         if (!head) return;
 
-        this->setWidth(head->width());
-        this->setHeight(head->height());
-        this->setRefresh(head->refreshRate());
+        this->describeHead(head);
         this->setX(head->x());
         this->setY(head->y());
         this->setRelativeOutput(head->relativeTo());
@@ -221,4 +281,37 @@ namespace bd::Config::Outputs {
         this->setPrimary(head->primary());
         this->setDisabled(!head->enabled());
     }
+
+    void Output::describeHead(const QSharedPointer<bd::Outputs::Wlr::MetaHead>& head) {
+        if (!head) return;
+
+        this->setMake(head->make());
+        this->setModel(head->model());
+        this->setConnector(head->name());
+        this->setWidth(head->width());
+        this->setHeight(head->height());
+        this->setRefresh(head->refreshRate());
+    }
+
+    QSharedPointer<Output> Output::clone() const {
+        auto output = new Output();
+        output->m_identifier = this->m_identifier;
+        output->m_make = this->m_make;
+        output->m_model = this->m_model;
+        output->m_connector = this->m_connector;
+        output->m_width = this->m_width;
+        output->m_height = this->m_height;
+        output->m_refresh = this->m_refresh;
+        output->m_x = this->m_x;
+        output->m_y = this->m_y;
+        output->m_relativeOutput = this->m_relativeOutput;
+        output->m_horizontalAnchor = this->m_horizontalAnchor;
+        output->m_verticalAnchor = this->m_verticalAnchor;
+        output->m_transform = this->m_transform;
+        output->m_adaptiveSync = this->m_adaptiveSync;
+        output->m_scale = this->m_scale;
+        output->m_primary = this->m_primary;
+        output->m_disabled = this->m_disabled;
+        return QSharedPointer<Output>(output);
+    }
 }
\ No newline at end of file
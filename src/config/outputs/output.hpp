@@ -4,6 +4,7 @@
 #include <QSharedPointer>
 #include <toml.hpp>
 
+#include "config/emitter.hpp"
 #include "outputs/config/enums/anchors.hpp"
 #include "outputs/wlr/metahead.hpp"
 
@@ -11,6 +12,10 @@ namespace bd::Config::Outputs {
     class Output : public QObject {
         Q_OBJECT
         Q_PROPERTY(QString identifier READ identifier WRITE setIdentifier NOTIFY identifierChanged)
+        // What the output was last seen as, used to adapt groups to a different monitor of the same kind or on the same connector
+        Q_PROPERTY(QString make READ make WRITE setMake NOTIFY makeChanged)
+        Q_PROPERTY(QString model READ model WRITE setModel NOTIFY modelChanged)
+        Q_PROPERTY(QString connector READ connector WRITE setConnector NOTIFY connectorChanged)
 
         // Dimensions
         Q_PROPERTY(int width READ width WRITE setWidth NOTIFY widthChanged)
@@ -38,6 +43,9 @@ namespace bd::Config::Outputs {
         // Property getters
         public:
             QString identifier() const;
+            QString make() const;
+            QString model() const;
+            QString connector() const;
             int width();
             int height();
             qulonglong refresh();
@@ -54,10 +62,13 @@ namespace bd::Config::Outputs {
 
             // Property setters
             void setAdaptiveSync(uint32_t adaptiveSync);
+            void setConnector(const QString& connector);
             void setDisabled(bool disabled);
             void setHeight(int height);
             void setHorizontalAnchor(bd::Outputs::Config::HorizontalAnchor::Type horizontalAnchor);
             void setIdentifier(const QString& identifier);
+            void setMake(const QString& make);
+            void setModel(const QString& model);
             void setPrimary(bool primary);
             void setRefresh(qulonglong refresh);
             void setRelativeOutput(const QString& relativeOutput);
@@ -70,14 +81,22 @@ namespace bd::Config::Outputs {
 
             // Other methods
             toml::ordered_value toToml();
+            // Same content as toToml, written out as a [[group.output]] table without building a tree first
+            void writeToml(bd::Config::TomlEmitter& emitter);
             void updateFromHead();
+            // Copies the current description of a head (make, model, connector and current mode) without touching placement
+            void describeHead(const QSharedPointer<bd::Outputs::Wlr::MetaHead>& head);
+            QSharedPointer<Output> clone() const;
 
     Q_SIGNALS:
         void adaptiveSyncChanged(uint32_t adaptiveSync);
+        void connectorChanged(const QString& connector);
         void disabledChanged(bool disabled);
         void heightChanged(int height);
         void horizontalAnchorChanged(bd::Outputs::Config::HorizontalAnchor::Type horizontalAnchor);
         void identifierChanged(const QString& identifier);
+        void makeChanged(const QString& make);
+        void modelChanged(const QString& model);
         void primaryChanged(bool primary);
         void refreshChanged(qulonglong refresh);
         void relativeOutputChanged(const QString& relativeOutput);
@@ -96,6 +115,9 @@ namespace bd::Config::Outputs {
         QSharedPointer<bd::Outputs::Wlr::MetaHead> getMetaHead();
 
         QString m_identifier;
+        QString m_make;
+        QString m_model;
+        QString m_connector;
         int m_width;
         int m_height;
         qulonglong m_refresh;
@@ -0,0 +1,208 @@
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QtEndian>
+#include <bit>
+
+#include "runtime_state.hpp"
+#include "config/utils.hpp"
+#include "sys/SysInfo.hpp"
+
+namespace bd::Config::Outputs {
+    namespace {
+        constexpr quint32 Magic = 0x42445253; // "BDRS"
+        // Anything beyond this is not a file we wrote
+        constexpr quint32 MaxRecords = 1024;
+
+        // Everything is stored little endian at fixed offsets, see RuntimeState::HeaderSize and RecordSize
+        template <typename T>
+        void put(QByteArray& bytes, qsizetype at, T value) {
+            qToLittleEndian(value, bytes.data() + at);
+        }
+
+        template <typename T>
+        T get(const QByteArray& bytes, qsizetype at) {
+            return qFromLittleEndian<T>(bytes.constData() + at);
+        }
+
+        QByteArray identifierHash(const QString& identifier) {
+            return QCryptographicHash::hash(identifier.toUtf8(), QCryptographicHash::Sha1);
+        }
+
+        // Leading bytes of the SHA-1 of everything but the checksum itself, at offset 12. Covers the records, so a store cut short
+        // halfway doesn't pass for a layout.
+        quint32 checksum(const QByteArray& bytes) {
+            QCryptographicHash hash(QCryptographicHash::Sha1);
+            hash.addData(QByteArrayView(bytes).first(12));
+            hash.addData(QByteArrayView(bytes).sliced(16));
+            return get<quint32>(hash.result(), 0);
+        }
+    }
+
+    QString RuntimeState::path() {
+        bool isShimMode = SysInfo::instance().isShimMode();
+        return QString::fromStdString(ConfigUtils::getStatePath(isShimMode ? "display-state-shim.bin" : "display-state.bin").string());
+    }
+
+    QByteArray RuntimeState::groupKey(const QSharedPointer<Group>& group) {
+        return QCryptographicHash::hash(Group::identifierKey(group->storedIdentifiers()) + group->name().toUtf8(), QCryptographicHash::Sha1);
+    }
+
+    bool RuntimeState::load() {
+        auto file = QFile(path());
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        auto data = file.readAll();
+
+        // Whatever is there, the next store diffs against it
+        m_contents = data;
+        m_key.clear();
+        m_saved_at = 0;
+        m_records.clear();
+
+        if (data.size() < HeaderSize || get<quint32>(data, 0) != Magic || get<quint32>(data, 4) != Version) return false;
+        auto count = get<quint32>(data, 8);
+        if (count > MaxRecords || data.size() != HeaderSize + qsizetype(count) * RecordSize) return false;
+        if (get<quint32>(data, 12) != checksum(data)) return false;
+
+        QList<Record> records;
+        for (quint32 i = 0; i < count; i++) {
+            auto at = HeaderSize + qsizetype(i) * RecordSize;
+            auto flags = get<quint16>(data, at + 54);
+            records.append(Record {
+                data.mid(at, 20),
+                get<qint32>(data, at + 20),
+                get<qint32>(data, at + 24),
+                get<qint32>(data, at + 28),
+                get<qint32>(data, at + 32),
+                get<quint64>(data, at + 36),
+                std::bit_cast<double>(get<quint64>(data, at + 44)),
+                get<quint16>(data, at + 52),
+                (flags & 0x1) != 0,
+                (flags & 0x2) != 0,
+                get<quint32>(data, at + 56),
+            });
+        }
+
+        m_key = data.mid(24, 20);
+        m_saved_at = get<qint64>(data, 16);
+        m_records = records;
+        return true;
+    }
+
+    qint64 RuntimeState::savedAt() const {
+        return m_saved_at;
+    }
+
+    bool RuntimeState::restore(const QSharedPointer<Group>& group) const {
+        if (!group || m_records.isEmpty() || m_key != groupKey(group)) return false;
+
+        bool restored = false;
+        for (const auto& output : group->outputConfigs()) {
+            auto hash = identifierHash(output->identifier());
+            for (const auto& record : m_records) {
+                if (record.identifier != hash) continue;
+                output->setX(record.x);
+                output->setY(record.y);
+                output->setWidth(record.width);
+                output->setHeight(record.height);
+                output->setRefresh(record.refresh);
+                output->setScale(record.scale);
+                output->setTransform(record.transform);
+                output->setAdaptiveSync(record.adaptiveSync);
+                output->setPrimary(record.primary);
+                output->setDisabled(record.disabled);
+                restored = true;
+                break;
+            }
+        }
+        return restored;
+    }
+
+    QByteArray RuntimeState::encode(const QByteArray& key, qint64 savedAt, const QList<Record>& records) {
+        QByteArray bytes(HeaderSize + records.size() * RecordSize, '\0');
+        put<quint32>(bytes, 0, Magic);
+        put<quint32>(bytes, 4, Version);
+        put<quint32>(bytes, 8, quint32(records.size()));
+        put<qint64>(bytes, 16, savedAt);
+        bytes.replace(24, key.size(), key);
+
+        for (qsizetype i = 0; i < records.size(); i++) {
+            const auto& record = records.at(i);
+            auto at = HeaderSize + i * RecordSize;
+            bytes.replace(at, record.identifier.size(), record.identifier);
+            put<qint32>(bytes, at + 20, record.x);
+            put<qint32>(bytes, at + 24, record.y);
+            put<qint32>(bytes, at + 28, record.width);
+            put<qint32>(bytes, at + 32, record.height);
+            put<quint64>(bytes, at + 36, record.refresh);
+            put<quint64>(bytes, at + 44, std::bit_cast<quint64>(record.scale));
+            put<quint16>(bytes, at + 52, record.transform);
+            put<quint16>(bytes, at + 54, quint16((record.primary ? 0x1 : 0) | (record.disabled ? 0x2 : 0)));
+            put<quint32>(bytes, at + 56, record.adaptiveSync);
+        }
+        put<quint32>(bytes, 12, checksum(bytes));
+        return bytes;
+    }
+
+    bool RuntimeState::open() {
+        if (m_file.isOpen()) return true;
+
+        m_file.setFileName(path());
+        QDir().mkpath(QFileInfo(m_file).absolutePath());
+        if (!m_file.open(QIODevice::ReadWrite)) {
+            qWarning() << "Failed to open" << m_file.fileName() << ":" << m_file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    bool RuntimeState::store(const QSharedPointer<Group>& group) {
+        if (!group) return false;
+
+        QList<Record> records;
+        for (const auto& output : group->outputConfigs()) {
+            records.append(Record {
+                identifierHash(output->identifier()),
+                output->x(),
+                output->y(),
+                output->width(),
+                output->height(),
+                output->refresh(),
+                output->scale(),
+                output->transform(),
+                output->primary(),
+                output->disabled(),
+                output->adaptiveSync(),
+            });
+            if (records.size() == qsizetype(MaxRecords)) break;
+        }
+
+        auto key = groupKey(group);
+        auto saved_at = QDateTime::currentMSecsSinceEpoch();
+        auto bytes = encode(key, saved_at, records);
+        if (!open()) return false;
+
+        // Only the records that changed are written, in place, and the header with its checksum last
+        bool ok = bytes.size() == m_contents.size() || m_file.resize(bytes.size());
+        for (qsizetype at = HeaderSize; ok && at < bytes.size(); at += RecordSize) {
+            if (at + RecordSize <= m_contents.size() && bytes.mid(at, RecordSize) == m_contents.mid(at, RecordSize)) continue;
+            ok = m_file.seek(at) && m_file.write(bytes.constData() + at, RecordSize) == RecordSize;
+        }
+        ok = ok && m_file.flush() && m_file.seek(0) && m_file.write(bytes.constData(), HeaderSize) == HeaderSize && m_file.flush();
+
+        if (!ok) {
+            qWarning() << "Failed to write" << m_file.fileName() << ":" << m_file.errorString();
+            // Don't trust what is on disk, the next store writes everything
+            m_contents.clear();
+            m_file.close();
+            return false;
+        }
+
+        m_contents = bytes;
+        m_key = key;
+        m_saved_at = saved_at;
+        m_records = records;
+        return true;
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+#include "group.hpp"
+
+namespace bd::Config::Outputs {
+    // Last known state of the outputs of the active group in shim mode, where the compositor and not the config drives the layout.
+    // Kept apart from the TOML so following the heads doesn't rewrite the user's file: a fixed-size header followed by one fixed-size
+    // record per output, updated in place and only where a record changed. The header goes last and carries a checksum of the
+    // records, a file left halfway is ignored. Losing it costs nothing but the latest tweaks, so there is no fsync or rename involved.
+    class RuntimeState {
+    public:
+        // Bump whenever the record layout changes
+        static constexpr quint32 Version = 2;
+        static constexpr qsizetype HeaderSize = 48;
+        static constexpr qsizetype RecordSize = 64;
+
+        static QString path();
+
+        // Reads the file, false if there is none or it isn't one we wrote
+        bool load();
+        // Milliseconds since the epoch of the last store, 0 when nothing was loaded or stored
+        qint64 savedAt() const;
+        // Overlays the stored state on the group's outputs if it was stored for this group, returns whether it was
+        bool restore(const QSharedPointer<Group>& group) const;
+        // Captures the group's outputs, only rewriting the parts of the file that differ from what is there already
+        bool store(const QSharedPointer<Group>& group);
+
+    private:
+        struct Record {
+            QByteArray identifier; // SHA-1 of the output identifier
+            qint32 x;
+            qint32 y;
+            qint32 width;
+            qint32 height;
+            quint64 refresh;
+            double scale;
+            quint16 transform;
+            bool primary;
+            bool disabled;
+            quint32 adaptiveSync;
+        };
+
+        // Identifies a group by its name and its outputs, a compatible group with another name has its own layout
+        static QByteArray groupKey(const QSharedPointer<Group>& group);
+        static QByteArray encode(const QByteArray& key, qint64 savedAt, const QList<Record>& records);
+        bool open();
+
+        QFile m_file;
+        // What the file holds right now, diffed against on every store
+        QByteArray m_contents;
+        QByteArray m_key;
+        qint64 m_saved_at = 0;
+        QList<Record> m_records;
+    };
+}
@@ -1,14 +1,109 @@
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QFile>
-#include <QTextStream>
+#include <QFileInfo>
+#include <QRect>
+#include <QSet>
 
 #include "state.hpp"
+#include "outputs/config/model.hpp"
 #include "outputs/state.hpp"
 #include "sys/SysInfo.hpp"
 #include "utils.hpp"
 
 namespace bd::Config::Outputs {
+    namespace {
+        // Weights for pairing a stored output with a present head, see State::createAdaptedGroup
+        constexpr int IdentifierMatchScore = 100;
+        constexpr int MakeModelMatchScore  = 60;
+        constexpr int ConnectorMatchScore  = 30;
+        // Charged for every stored output without a head and every head without a stored output
+        constexpr int UnmatchedPenalty = 25;
+
+        int scoreOutputForHead(const QSharedPointer<Output>& output, const QSharedPointer<bd::Outputs::Wlr::MetaHead>& head) {
+            if (output->identifier() == head->getIdentifier()) return IdentifierMatchScore;
+
+            bool same_make_model = !output->make().isEmpty() && !output->model().isEmpty() && output->make() == head->make() && output->model() == head->model();
+            bool same_connector  = !output->connector().isEmpty() && output->connector() == head->name();
+            if (same_make_model) return MakeModelMatchScore + (same_connector ? ConnectorMatchScore / 3 : 0);
+            if (same_connector) return ConnectorMatchScore;
+            return 0;
+        }
+
+        // Pairs stored outputs with heads, best pairs first, and returns the group's score. Pairs are keyed on the stored identifier.
+        int scoreGroup(const QSharedPointer<Group>& group, const QList<QSharedPointer<bd::Outputs::Wlr::MetaHead>>& heads,
+                       QHash<QString, QSharedPointer<bd::Outputs::Wlr::MetaHead>>& pairs) {
+            struct Candidate {
+                int score;
+                qsizetype output;
+                qsizetype head;
+            };
+
+            auto outputs = group->outputConfigs();
+            QList<Candidate> candidates;
+            for (qsizetype o = 0; o < outputs.size(); o++) {
+                for (qsizetype h = 0; h < heads.size(); h++) {
+                    auto score = scoreOutputForHead(outputs.at(o), heads.at(h));
+                    if (score > 0) candidates.append({score, o, h});
+                }
+            }
+            std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+
+            QSet<qsizetype> used_outputs;
+            QSet<qsizetype> used_heads;
+            int total = 0;
+            for (const auto& candidate : candidates) {
+                if (used_outputs.contains(candidate.output) || used_heads.contains(candidate.head)) continue;
+                used_outputs.insert(candidate.output);
+                used_heads.insert(candidate.head);
+                pairs.insert(outputs.at(candidate.output)->identifier(), heads.at(candidate.head));
+                total += candidate.score;
+            }
+
+            if (pairs.isEmpty()) return 0;
+            return total - UnmatchedPenalty * static_cast<int>((outputs.size() - used_outputs.size()) + (heads.size() - used_heads.size()));
+        }
+    }
+
     State::State(QObject* parent) : QObject(parent), m_activeGroup(nullptr), m_matchingGroup(nullptr), m_preferences(new GlobalPreferences(this)),
-     m_groups(QList<QSharedPointer<Group>>()) {}
+     m_groups(QList<QSharedPointer<Group>>()), m_group_index_dirty(true), m_save_timer(new QTimer(this)), m_reload_timer(new QTimer(this)),
+     m_runtime_timer(new QTimer(this)), m_plans_timer(new QTimer(this)), m_watcher(new QFileSystemWatcher(this)),
+     m_writer(new bd::Config::Writer(this)), m_last_saved(QByteArray()) {
+        // Hotplug and shim mode trigger saves in bursts, only write once they settle
+        m_save_timer->setSingleShot(true);
+        m_save_timer->setInterval(500);
+        connect(m_save_timer, &QTimer::timeout, this, &State::writeNow);
+        connect(m_writer, &bd::Config::Writer::written, this, &State::onWritten);
+
+        // Editors and config management tend to write in several steps, give them a moment before reading the file back
+        m_reload_timer->setSingleShot(true);
+        m_reload_timer->setInterval(200);
+        connect(m_reload_timer, &QTimer::timeout, this, &State::reload);
+        connect(m_watcher, &QFileSystemWatcher::fileChanged, m_reload_timer, qOverload<>(&QTimer::start));
+        // The directory also sees the temp files saves go through, only the config itself being replaced or removed counts
+        connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, [this]() {
+            auto stamp = configStamp();
+            if (stamp == m_config_stamp) return;
+            m_config_stamp = stamp;
+            m_reload_timer->start();
+        });
+
+        // Heads report a change one property at a time, record the state they end up in
+        m_runtime_timer->setSingleShot(true);
+        m_runtime_timer->setInterval(100);
+        connect(m_runtime_timer, &QTimer::timeout, this, &State::storeRuntimeState);
+
+        // Plans are calculated off the back of hotplugs, which come in bursts too
+        m_plans_timer->setSingleShot(true);
+        m_plans_timer->setInterval(250);
+        connect(m_plans_timer, &QTimer::timeout, this, &State::precomputePlans);
+
+        // Don't lose a pending save on the way out
+        if (QCoreApplication::instance()) connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &State::flush);
+    }
 
     State& State::instance() {
         static State _instance(nullptr);
@@ -32,6 +127,7 @@ namespace bd::Config::Outputs {
     }
 
     void State::setActiveGroup(QSharedPointer<Group> activeGroup) {
+        if (m_activeGroup == activeGroup) return;
         m_activeGroup = activeGroup;
         emit activeGroupChanged(activeGroup);
     }
@@ -43,23 +139,212 @@ namespace bd::Config::Outputs {
 
     void State::setGroups(const QList<QSharedPointer<Group>>& groups) {
         m_groups = groups;
+        rebuildGroupIndex();
     }
 
     void State::apply() {
         auto matching_group = getMatchingGroup();
         // If we don't have a matching group, create a default one and dump its state so we have a default
         if (matching_group.isNull()) {
-            qDebug() << "No matching group found, creating a default one";
-            m_matchingGroup = createDefaultGroup();
+            // Prefer starting from a group that covers most of the outputs over starting from scratch
+            m_matchingGroup = createAdaptedGroup();
+            if (m_matchingGroup.isNull()) {
+                qDebug() << "No matching group found, creating a default one";
+                m_matchingGroup = createDefaultGroup();
+            }
             matching_group = m_matchingGroup;
             m_groups.append(m_matchingGroup);
+            rebuildGroupIndex();
         }
 
         // Apply the configuration for the matching group
+        matching_group->markUsed();
         matching_group->apply();
 
-        // Set the active group to the matching group
-        m_activeGroup = matching_group;
+        // Set the active group to the matching group, ahead of compacting so the group being applied is never dropped
+        m_matchingGroup = matching_group;
+        setActiveGroup(matching_group);
+
+        // Every new topology adds a group, keep their number in check
+        compact();
+
+        // Have the alternatives ready once things settle, and again once outputs stop coming and going
+        auto &orchestrator = bd::Outputs::State::instance();
+        connect(&orchestrator, &bd::Outputs::State::availableOutputsChanged, m_plans_timer, qOverload<>(&QTimer::start), Qt::UniqueConnection);
+        m_plans_timer->start();
+    }
+
+    QString State::configPath() const {
+        bool isShimMode = SysInfo::instance().isShimMode();
+        return QString::fromStdString(ConfigUtils::getConfigPath(isShimMode ? "display-config-shim.toml" : "display-config.toml").string());
+    }
+
+    QStringList State::systemConfigPaths() const {
+        bool isShimMode = SysInfo::instance().isShimMode();
+        QStringList paths;
+        for (const auto& path : ConfigUtils::getSystemConfigPaths(isShimMode ? "display-config-shim.toml" : "display-config.toml")) {
+            paths.append(QString::fromStdString(path.string()));
+        }
+        return paths;
+    }
+
+    bool State::loadSystemLayer() {
+        QByteArray content;
+        QList<QPair<QString, QByteArray>> files;
+        for (const auto& path : systemConfigPaths()) {
+            auto file = QFile(path);
+            if (!file.open(QIODevice::ReadOnly)) continue;
+            files.append({path, file.readAll()});
+            content.append(path.toUtf8()).append('\0').append(files.last().second).append('\0');
+        }
+
+        // The groups we have may be the active or matching one and are what userGroups tells apart, leave them be unless there is news
+        if (content == m_system_content) return false;
+
+        QList<QSharedPointer<Group>> groups;
+        GlobalPreferences preferences;
+        for (const auto& [path, data] : files) {
+            // Not ours to back up or fix, skip what can't be read and carry on with the rest
+            QList<QSharedPointer<Group>> layer;
+            QList<bd::Outputs::ConfigDiagnostic> diagnostics;
+            try {
+                parse(toml::parse_str(data.toStdString()), layer, preferences, diagnostics);
+            } catch (const std::exception& e) {
+                qWarning() << "Error reading system display config" << path << ": " << e.what();
+                continue;
+            }
+            for (const auto& diagnostic : diagnostics) {
+                qWarning() << "System display config" << path << diagnostic.severity << "at" << diagnostic.location << ":" << diagnostic.message;
+            }
+
+            // A more important directory replaces groups of the same name
+            for (const auto& group : layer) {
+                groups.removeIf([&group](const auto& existing) { return existing->name() == group->name(); });
+                groups.append(group);
+            }
+        }
+
+        m_system_content = content;
+        m_system_groups = groups;
+        m_system_baselines.clear();
+        for (const auto& group : groups) m_system_baselines.insert(group, effectiveConfig(group));
+        m_system_preferences.assign(preferences);
+        if (!groups.isEmpty()) qDebug() << "Loaded" << groups.size() << "groups from the system display config";
+        return true;
+    }
+
+    void State::setUserGroups(const QList<QSharedPointer<Group>>& groups) {
+        // Merged once here, lookups go through the group index built from the result
+        QSet<QString> names;
+        for (const auto& group : groups) names.insert(group->name());
+
+        m_groups = groups;
+        for (const auto& group : m_system_groups) {
+            if (!names.contains(group->name())) m_groups.append(group);
+        }
+        rebuildGroupIndex();
+    }
+
+    QList<QSharedPointer<Group>> State::userGroups() const {
+        QList<QSharedPointer<Group>> groups;
+        for (const auto& group : m_groups) {
+            auto baseline = m_system_baselines.constFind(group);
+            if (baseline != m_system_baselines.constEnd() && *baseline == effectiveConfig(group)) continue;
+            groups.append(group);
+        }
+        return groups;
+    }
+
+    void State::parse(const toml::value& data, QList<QSharedPointer<Group>>& groups, GlobalPreferences& preferences,
+                      QList<bd::Outputs::ConfigDiagnostic>& diagnostics) const {
+        // toml11 errors come with a multi-line excerpt of the file, the first line says what is wrong
+        auto describe = [](const std::exception& e) { return QString::fromUtf8(e.what()).section('\n', 0, 0).trimmed(); };
+
+        if (data.contains("preferences")) {
+            try {
+                const auto& preferences_table = data.at("preferences");
+                if (preferences_table.contains("automatic_attach_outputs_relative_position")) {
+                    auto pos = preferences_table.at("automatic_attach_outputs_relative_position");
+                    if (pos.is_string()) {
+                      auto value = std::string_view {pos.as_string()};
+                      preferences.setAutomaticAttachOutputsRelativePosition(Config::Outputs::GlobalPreferences::fromString(std::string(value)));
+                    }
+                }
+
+                preferences.setMaxAutoGeneratedGroups(toml::find_or<int>(preferences_table, "max_auto_generated_groups", preferences.maxAutoGeneratedGroups()));
+                preferences.setAutoGeneratedGroupMaxAgeDays(
+                    toml::find_or<int>(preferences_table, "auto_generated_group_max_age_days", preferences.autoGeneratedGroupMaxAgeDays()));
+            } catch (const std::exception& e) {
+                diagnostics.append({"warning", "preferences", QString("Using defaults: %1").arg(describe(e))});
+            }
+        }
+
+        if (data.contains("group") && !data.at("group").is_array()) {
+            diagnostics.append({"error", "group", "Skipped: group is not an array of tables"});
+            return;
+        }
+
+        // Iterate over each group and create the Group objects, a bad group only costs us that group
+        auto group_tables = toml::find_or<std::vector<toml::value>>(data, "group", {});
+        for (qsizetype i = 0; i < static_cast<qsizetype>(group_tables.size()); i++) {
+            auto location = QString("group[%1]").arg(i);
+            try {
+                groups.append(QSharedPointer<Group>(new bd::Config::Outputs::Group(group_tables.at(i), location, diagnostics)));
+            } catch (const std::exception& e) {
+                diagnostics.append({"error", location, QString("Skipped: %1").arg(describe(e))});
+            }
+        }
+    }
+
+    QList<bd::Outputs::ConfigDiagnostic> State::lint() const {
+        QList<bd::Outputs::ConfigDiagnostic> diagnostics;
+        auto file = QFile(configPath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            diagnostics.append({"warning", QFileInfo(file).fileName(), "No display config yet"});
+        } else {
+            QList<QSharedPointer<Group>> groups;
+            GlobalPreferences preferences;
+            try {
+                parse(toml::parse_str(file.readAll().toStdString()), groups, preferences, diagnostics);
+            } catch (const std::exception& e) {
+                diagnostics.append({"error", QFileInfo(file).fileName(), QString::fromUtf8(e.what()).trimmed()});
+            }
+        }
+
+        // The system configs are layered under it, their problems end up in the effective config just the same
+        for (const auto& path : systemConfigPaths()) {
+            auto system_file = QFile(path);
+            if (!system_file.open(QIODevice::ReadOnly)) continue;
+
+            QList<QSharedPointer<Group>> layer;
+            GlobalPreferences layer_preferences;
+            QList<bd::Outputs::ConfigDiagnostic> layer_diagnostics;
+            try {
+                parse(toml::parse_str(system_file.readAll().toStdString()), layer, layer_preferences, layer_diagnostics);
+            } catch (const std::exception& e) {
+                layer_diagnostics.append({"error", QString(), QString::fromUtf8(e.what()).trimmed()});
+            }
+            for (auto diagnostic : layer_diagnostics) {
+                diagnostic.location = diagnostic.location.isEmpty() ? path : QString("%1: %2").arg(path, diagnostic.location);
+                diagnostics.append(diagnostic);
+            }
+        }
+        return diagnostics;
+    }
+
+    void State::report(const QByteArray& content, const QList<bd::Outputs::ConfigDiagnostic>& diagnostics) {
+        bool has_errors = false;
+        for (const auto& diagnostic : diagnostics) {
+            qWarning() << "Display config" << diagnostic.severity << "at" << diagnostic.location << ":" << diagnostic.message;
+            has_errors |= diagnostic.severity == "error";
+        }
+
+        // Whatever was skipped is gone from the next save, keep a copy of the file as it was so nothing is lost for good
+        if (has_errors && !content.isEmpty()) {
+            auto backup = configPath() + ".bak";
+            qWarning() << "Parts of the display config could not be read, a copy was kept at" << backup;
+            m_writer->write(backup, content);
+        }
     }
 
     void State::deserialize() {
@@ -67,58 +352,489 @@ namespace bd::Config::Outputs {
         auto config_location = ConfigUtils::getConfigPath(isShimMode ? "display-config-shim.toml" : "display-config.toml");
         ConfigUtils::ensureConfigPathExists(config_location);
 
-        try {
-            auto data = toml::parse(config_location);
-            if (data.contains("preferences")) {
-                auto position = data.at("preferences").at("automatic_attach_outputs_relative_position");
-                if (position.is_string()) {
-                  auto pos = std::string_view {position.as_string()};
-                  m_preferences->setAutomaticAttachOutputsRelativePosition(
-                      Config::Outputs::GlobalPreferences::fromString(std::string(pos)));
-                }
+        // The user config is layered over the system wide ones, which apply even before the user has a config of their own
+        loadSystemLayer();
+        m_preferences->assign(m_system_preferences);
+        setUserGroups({});
+
+        // Pick up edits made while we are running, this is set up even if there is no config yet
+        watch();
+
+        // A missing or unreadable history just starts over, it is only there for undo
+        auto history = QFile(History::path());
+        if (history.open(QIODevice::ReadOnly) && !m_history.decode(history.readAll())) qWarning() << "Ignoring unreadable display config history";
+
+        // No config yet, one is written once the first group is applied
+        auto existing = QFile(QString::fromStdString(config_location.string()));
+        if (!existing.open(QIODevice::ReadOnly)) return;
+
+        // Remember what is on disk, so saving the same state back is a no-op
+        m_last_saved = existing.readAll();
+        auto mtime = QFileInfo(existing).lastModified().toMSecsSinceEpoch();
+
+        QList<QSharedPointer<Group>> groups;
+        bool cached = Cache::load(m_last_saved + m_system_content, mtime, groups, *m_preferences);
+        bool clean = true;
+        if (cached) {
+            qDebug() << "Loaded display config from the startup cache";
+        } else {
+            QList<bd::Outputs::ConfigDiagnostic> diagnostics;
+            try {
+                parse(toml::parse_str(m_last_saved.toStdString()), groups, *m_preferences, diagnostics);
+            } catch (const std::exception& e) {
+                qWarning() << "Error deserializing display config: " << e.what();
+                diagnostics.append({"error", QFileInfo(existing).fileName(), QString::fromUtf8(e.what()).trimmed()});
+                report(m_last_saved, diagnostics);
+                return;
             }
+            report(m_last_saved, diagnostics);
+            clean = diagnostics.isEmpty();
+        }
+
+        setUserGroups(groups);
+        // Covers edits made while we weren't running
+        recordHistory();
+        // Don't let a cache hit hide problems from the next start, the next save caches the cleaned up config
+        if (!cached && clean) storeCache(m_last_saved, mtime);
+
+        m_matchingGroup = getMatchingGroup();
 
-            // Iterate over each group and create the Group objects
-            for (const auto& group_toml : toml::find<std::vector<toml::value>>(data, "group")) {
-                auto group = new bd::Config::Outputs::Group(group_toml);
-                m_groups.append(QSharedPointer<Group>(group));
+        // Older configs (or a lowered limit) may carry more groups than we want to keep, the matching group among them
+        if (compact() > 0) save();
+
+        // In shim mode the heads may have moved on since the config was last written, unless it was written (or edited) after that
+        if (isShimMode && m_runtime_state.load() && m_runtime_state.savedAt() > mtime) {
+            for (const auto& group : m_groups) {
+                if (!m_runtime_state.restore(group)) continue;
+                qDebug() << "Restored the last known state of group" << group->name();
+                break;
             }
+        }
+    }
+
+    void State::recordRuntimeState() {
+        m_runtime_timer->start();
+    }
+
+    void State::storeRuntimeState() {
+        if (!m_activeGroup) return;
+
+        // Kept in memory as well, so the next deliberate save carries it into the config
+        for (const auto& output : m_activeGroup->outputConfigs()) output->updateFromHead();
+        m_runtime_state.store(m_activeGroup);
+    }
+
+    void State::storeCache(const QByteArray& toml, qint64 mtime) {
+        // Goes through the writer as well, so it can't land before the TOML it describes
+        // Only the user layer is cached, system groups are cheap to read again. The system configs are part of the key as the
+        // preferences stored are the merged ones.
+        m_writer->write(Cache::path(), Cache::encode(toml + m_system_content, mtime, userGroups(), *m_preferences));
+    }
+
+    QPair<qint64, qint64> State::configStamp() const {
+        auto info = QFileInfo(configPath());
+        if (!info.exists()) return {-1, -1};
+        return {info.lastModified().toMSecsSinceEpoch(), info.size()};
+    }
+
+    void State::watch() {
+        // Saves (ours included) replace the file through a rename, which drops a watch on the file itself, so watch the directory as well
+        auto path = configPath();
+        auto directory = QFileInfo(path).absolutePath();
+        if (!m_watcher->directories().contains(directory)) m_watcher->addPath(directory);
+        m_config_stamp = configStamp();
+        if (QFile::exists(path) && !m_watcher->files().contains(path)) m_watcher->addPath(path);
+
+        // System configs are only looked at if they were there to begin with, they are installed rather than created on the fly
+        for (const auto& system_path : systemConfigPaths()) {
+            if (QFile::exists(system_path) && !m_watcher->files().contains(system_path)) m_watcher->addPath(system_path);
+        }
+    }
+
+    void State::reload() {
+        // Until our own writes have landed the file holds an older save, which would pass for an edit
+        if (m_pending_writes > 0) {
+            m_reload_timer->start();
+            return;
+        }
+
+        watch();
+
+        // The system configs may have changed as well, keep the user groups we have in case the user config can't be read
+        auto user_groups = userGroups();
+        bool system_changed = loadSystemLayer();
+
+        auto path = configPath();
+        auto file = QFile(path);
+        if (!file.open(QIODevice::ReadOnly) && !system_changed) return;
+        auto content = file.isOpen() ? file.readAll() : m_last_saved;
+
+        // Our own writes, or a touch without changes
+        if (content == m_last_saved && !system_changed) return;
+
+        qInfo() << "Display config changed on disk, reloading";
 
-            m_matchingGroup = getMatchingGroup();
+        QList<QSharedPointer<Group>> groups;
+        GlobalPreferences preferences;
+        preferences.assign(m_system_preferences);
+        QList<bd::Outputs::ConfigDiagnostic> diagnostics;
+        try {
+            parse(toml::parse_str(content.toStdString()), groups, preferences, diagnostics);
+            report(content, diagnostics);
         } catch (const std::exception& e) {
-            if (QString(e.what()).contains("error opening file")) return;
-            qWarning() << "Error deserializing display config: " << e.what();
+            // Keep running with what we have, the next edit may well fix it
+            qWarning() << "Error reloading display config, keeping the current one: " << e.what();
+            diagnostics.append({"error", QFileInfo(file).fileName(), QString::fromUtf8(e.what()).trimmed()});
+            report(content, diagnostics);
+            if (!system_changed) return;
+
+            // Still take in the system configs, under the user groups and preferences we had
+            groups = user_groups;
+            preferences.assign(*m_preferences);
+            content = m_last_saved;
+        }
+
+        // Compare the effective configuration of the active group before we swap the groups out
+        auto previous = m_activeGroup ? effectiveConfig(m_activeGroup) : QByteArray();
+
+        m_last_saved = content;
+        m_preferences->assign(preferences);
+        setUserGroups(groups);
+        if (diagnostics.isEmpty() && file.isOpen()) storeCache(content, QFileInfo(file).lastModified().toMSecsSinceEpoch());
+        recordHistory();
+
+        // In shim mode the heads drive the layout and the file only catches up on the next deliberate save. Compare against what they
+        // last did, or an edit anywhere in the file would put the active group back the way it was when it was last written.
+        if (SysInfo::instance().isShimMode()) {
+            for (const auto& group : m_groups) {
+                if (m_runtime_state.restore(group)) break;
+            }
+        }
+        m_matchingGroup = getMatchingGroup();
+
+        auto current = m_matchingGroup ? effectiveConfig(m_matchingGroup) : QByteArray();
+        if (m_activeGroup && previous == current) {
+            // Nothing that affects the outputs changed, just point at the reloaded group
+            qDebug() << "Active group unchanged by the reload, not reapplying";
+            setActiveGroup(m_matchingGroup);
+            return;
         }
+
+        apply();
     }
 
     void State::save() {
-        // Ensure 
-        bool isShimMode = SysInfo::instance().isShimMode();
-        toml::ordered_value config(toml::ordered_table {});
-        config.as_table_fmt().fmt = toml::table_format::multiline;
+        // (Re)start the debounce, the actual write happens in writeNow
+        m_save_timer->start();
+    }
 
-        toml::ordered_value preferences_table(toml::ordered_table {});
-        preferences_table["automatic_attach_outputs_relative_position"] = Config::Outputs::GlobalPreferences::toStringStd(m_preferences->automaticAttachOutputsRelativePosition());
+    void State::flush() {
+        if (m_runtime_timer->isActive()) {
+            m_runtime_timer->stop();
+            storeRuntimeState();
+        }
+        if (m_save_timer->isActive()) {
+            m_save_timer->stop();
+            writeNow();
+        }
+        m_writer->waitForDone();
+    }
 
-        config["preferences"] = preferences_table;
+    QByteArray State::serialize(bool includeUsage) const {
+        // Written straight into the buffer, formatting a toml11 tree of every group costs far more on configs with many groups
+        QByteArray serialized_config;
+        serialized_config.reserve(m_last_saved.size() + 1024);
+        bd::Config::TomlEmitter emitter(serialized_config);
 
-        toml::ordered_value groups(toml::ordered_array {});
-        groups.as_array_fmt().fmt = toml::array_format::array_of_tables;
-        for (const auto& group : m_groups) { groups.push_back(group->toToml()); }
+        // With system configs in place only what the user changed is written, so later fleet wide changes still come through
+        bool layered = !m_system_content.isEmpty();
+        emitter.table("preferences");
+        if (!layered || m_preferences->automaticAttachOutputsRelativePosition() != m_system_preferences.automaticAttachOutputsRelativePosition()) {
+            emitter.string("automatic_attach_outputs_relative_position", Config::Outputs::GlobalPreferences::toString(m_preferences->automaticAttachOutputsRelativePosition()));
+        }
+        if (!layered || m_preferences->maxAutoGeneratedGroups() != m_system_preferences.maxAutoGeneratedGroups()) {
+            emitter.integer("max_auto_generated_groups", m_preferences->maxAutoGeneratedGroups());
+        }
+        if (!layered || m_preferences->autoGeneratedGroupMaxAgeDays() != m_system_preferences.autoGeneratedGroupMaxAgeDays()) {
+            emitter.integer("auto_generated_group_max_age_days", m_preferences->autoGeneratedGroupMaxAgeDays());
+        }
 
-        config.as_table().emplace_back("group", groups);
+        for (const auto& group : userGroups()) group->writeToml(emitter, includeUsage);
 
-        auto serialized_config = toml::format(config);
-        auto config_location = ConfigUtils::getConfigPath(isShimMode ? "display-config-shim.toml" : "display-config.toml");
-        auto config_file       = QFile(config_location);
-    
-        if (config_file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-          QTextStream stream(&config_file);
-          stream << serialized_config.c_str();
-          config_file.close();
+        return serialized_config;
+    }
+
+    bool State::writeNow() {
+        if (m_group_index_dirty) rebuildGroupIndex();
+
+        // Serializing reads our QObjects, so it stays on this thread. Only the disk IO is handed off.
+        auto serialized_config = serialize();
+        if (serialized_config == m_last_saved) {
+            qDebug() << "Display config unchanged, skipping write";
+            return false;
+        }
+
+        m_last_saved = serialized_config;
+        m_pending_writes++;
+        m_writer->write(configPath(), serialized_config);
+        return recordHistory();
+    }
+
+    bool State::recordHistory() {
+        // Usage changes on every apply, only what the groups configure is worth going back to
+        if (!m_history.record(serialize(false), QDateTime::currentSecsSinceEpoch())) return false;
+        m_writer->write(History::path(), m_history.encode());
+        return true;
+    }
+
+    QList<History::Entry> State::history() const {
+        return m_history.entries();
+    }
+
+    bool State::undo(qsizetype n) {
+        if (n < 1) return false;
+
+        // A change still waiting for the debounce is the version being replaced, it has to be in the history before we restore over it.
+        // Indices are the ones ListHistory handed out before it got there, so they are now one further back.
+        if (m_save_timer->isActive()) {
+            m_save_timer->stop();
+            if (writeNow()) n++;
+        }
+        if (m_group_index_dirty) rebuildGroupIndex();
+
+        auto snapshot = m_history.snapshot(n);
+        if (!snapshot) {
+            qWarning() << "No display config" << n << "versions back";
+            return false;
+        }
+
+        QList<QSharedPointer<Group>> groups;
+        GlobalPreferences preferences;
+        preferences.assign(m_system_preferences);
+        QList<bd::Outputs::ConfigDiagnostic> diagnostics;
+        try {
+            parse(toml::parse_str(snapshot->toStdString()), groups, preferences, diagnostics);
+        } catch (const std::exception& e) {
+            qWarning() << "Error restoring display config from history: " << e.what();
+            return false;
+        }
+        for (const auto& diagnostic : diagnostics) {
+            qWarning() << "Restored display config" << diagnostic.severity << "at" << diagnostic.location << ":" << diagnostic.message;
+        }
+
+        // History doesn't keep usage or auto_generated (the parser guesses the latter from the name), carry them over from the groups we
+        // have now so retention isn't reset and a pinned group doesn't become fair game for compaction
+        for (const auto& group : groups) {
+            auto key = Group::identifierKey(group->storedIdentifiers());
+            for (const auto& current : m_group_index.value(key)) {
+                if (current->name() != group->name()) continue;
+                group->setUsage(current->lastUsed(), current->useCount());
+                group->setAutoGenerated(current->autoGenerated());
+                break;
+            }
+        }
+
+        qInfo() << "Restoring display config from" << n << "versions back";
+        m_preferences->assign(preferences);
+        setUserGroups(groups);
+
+        // A group made for exactly these outputs goes out with its plan, anything else is handled like a hotplug, including falling back
+        // to an adapted or default group if that version had nothing for these outputs
+        auto matching_group = getMatchingGroup();
+        if (matching_group) {
+            matching_group->markUsed();
+            matching_group->apply(planFor(matching_group));
+            m_matchingGroup = matching_group;
+            setActiveGroup(matching_group);
+            compact();
         } else {
-          qWarning() << "Failed to open display-config.toml for writing";
+            apply();
+        }
+
+        save();
+        return true;
+    }
+
+    void State::onWritten(const QString& path, const QByteArray& data, bool success) {
+        // The startup cache is best effort, the next start simply parses the TOML again
+        if (path != configPath()) {
+            if (!success) qWarning() << "Failed to write" << path;
+            return;
+        }
+
+        m_pending_writes--;
+        if (!success) {
+            qWarning() << "Failed to write" << path;
+            // Let the next save try again rather than assuming this content is on disk
+            if (m_last_saved == data) m_last_saved.clear();
+            return;
+        }
+
+        // Only cache what we hold in memory if it is exactly what was written, a newer save will refresh it otherwise
+        if (!m_save_timer->isActive() && data == serialize()) storeCache(data, QFileInfo(path).lastModified().toMSecsSinceEpoch());
+
+        emit saved();
+    }
+
+    QSharedPointer<Group> State::createAdaptedGroup() {
+        auto &orchestrator = bd::Outputs::State::instance();
+        auto manager = orchestrator.getManager();
+        if (manager.isNull()) return QSharedPointer<Group>(nullptr);
+
+        auto heads = manager->getHeads();
+        for (const auto& head : heads) {
+            if (head->getIdentifier().isEmpty()) return QSharedPointer<Group>(nullptr);
+        }
+
+        // Score every group, ties go to the preferred and then the most recently used one
+        QSharedPointer<Group> best;
+        QHash<QString, QSharedPointer<bd::Outputs::Wlr::MetaHead>> best_pairs;
+        int best_score = 0;
+        for (const auto& group : m_groups) {
+            QHash<QString, QSharedPointer<bd::Outputs::Wlr::MetaHead>> pairs;
+            auto score = scoreGroup(group, heads, pairs);
+            if (score <= 0) continue;
+
+            bool better = score > best_score;
+            if (!better && score == best_score && best) {
+                better = group->preferred() != best->preferred() ? group->preferred() : group->lastUsed() > best->lastUsed();
+            }
+            if (!better) continue;
+
+            best = group;
+            best_pairs = pairs;
+            best_score = score;
+        }
+
+        if (!best) return QSharedPointer<Group>(nullptr);
+        qDebug() << "Adapting group" << best->name() << "with score" << best_score;
+
+        // Stored identifier to the identifier of the head that takes its place
+        QHash<QString, QString> renamed;
+        for (auto it = best_pairs.constBegin(); it != best_pairs.constEnd(); ++it) renamed.insert(it.key(), it.value()->getIdentifier());
+
+        bool is_shim_mode = SysInfo::instance().isShimMode();
+        QStringList identifiers;
+        QList<QSharedPointer<Output>> output_configs;
+        QRect placed;
+
+        for (const auto& stored : best->outputConfigs()) {
+            auto head = best_pairs.value(stored->identifier());
+            if (!head) continue;
+
+            auto output = stored->clone();
+            output->setIdentifier(head->getIdentifier());
+            output->setMake(head->make());
+            output->setModel(head->model());
+            output->setConnector(head->name());
+
+            // A different monitor of the same kind may still lack the stored mode
+            if (head->getModeForOutputHead(output->width(), output->height(), output->refresh()).isNull()) output->describeHead(head);
+
+            // Anchors to outputs that are gone can't be kept
+            if (!output->relativeOutput().isEmpty()) {
+                if (renamed.contains(output->relativeOutput())) {
+                    output->setRelativeOutput(renamed.value(output->relativeOutput()));
+                } else {
+                    output->setRelativeOutput("");
+                    output->setHorizontalAnchor(bd::Outputs::Config::HorizontalAnchor::None);
+                    output->setVerticalAnchor(bd::Outputs::Config::VerticalAnchor::None);
+                }
+            }
+
+            if (!output->disabled()) {
+                auto scale = output->scale() > 0 ? output->scale() : 1.0;
+                placed = placed.united(QRect(output->x(), output->y(), qRound(output->width() / scale), qRound(output->height() / scale)));
+            }
+
+            identifiers.append(output->identifier());
+            output_configs.append(output);
+        }
+
+        auto primary = renamed.value(best->storedPrimaryOutputIdentifier(), identifiers.isEmpty() ? QString() : identifiers.first());
+
+        // Outputs the group doesn't know about are attached to the previous one, following the automatic attach preference
+        auto position = m_preferences->automaticAttachOutputsRelativePosition();
+        auto previous = primary;
+        auto extra_heads = QList<QSharedPointer<bd::Outputs::Wlr::MetaHead>>();
+        for (const auto& head : heads) {
+            if (!identifiers.contains(head->getIdentifier())) extra_heads.append(head);
+        }
+        std::sort(extra_heads.begin(), extra_heads.end(), [](const auto& a, const auto& b) { return a->name() < b->name(); });
+
+        for (const auto& head : extra_heads) {
+            auto output = QSharedPointer<Output>(new Output());
+            output->setIdentifier(head->getIdentifier());
+            output->describeHead(head);
+            output->setScale(head->scale());
+            output->setTransform(head->transform());
+            output->setAdaptiveSync(head->adaptiveSync());
+            output->setDisabled(false);
+
+            auto scale = output->scale() > 0 ? output->scale() : 1.0;
+            auto size = QSize(qRound(output->width() / scale), qRound(output->height() / scale));
+
+            if (is_shim_mode) {
+                // No anchors in shim mode, lay it out next to what is there already
+                auto origin = QPoint(0, 0);
+                if (!placed.isNull()) {
+                    switch (position) {
+                        case GlobalPreferences::Left:
+                            origin = placed.topLeft() - QPoint(size.width(), 0);
+                            break;
+                        case GlobalPreferences::Above:
+                            origin = placed.topLeft() - QPoint(0, size.height());
+                            break;
+                        case GlobalPreferences::Below:
+                            origin = placed.bottomLeft() + QPoint(0, 1);
+                            break;
+                        default:
+                            origin = placed.topRight() + QPoint(1, 0);
+                            break;
+                    }
+                }
+                output->setX(origin.x());
+                output->setY(origin.y());
+                placed = placed.united(QRect(origin, size));
+            } else if (position != GlobalPreferences::None && !previous.isEmpty()) {
+                output->setRelativeOutput(previous);
+                switch (position) {
+                    case GlobalPreferences::Left:
+                        output->setHorizontalAnchor(bd::Outputs::Config::HorizontalAnchor::Left);
+                        output->setVerticalAnchor(bd::Outputs::Config::VerticalAnchor::Top);
+                        break;
+                    case GlobalPreferences::Right:
+                        output->setHorizontalAnchor(bd::Outputs::Config::HorizontalAnchor::Right);
+                        output->setVerticalAnchor(bd::Outputs::Config::VerticalAnchor::Top);
+                        break;
+                    case GlobalPreferences::Above:
+                        output->setHorizontalAnchor(bd::Outputs::Config::HorizontalAnchor::Center);
+                        output->setVerticalAnchor(bd::Outputs::Config::VerticalAnchor::Above);
+                        break;
+                    case GlobalPreferences::Below:
+                        output->setHorizontalAnchor(bd::Outputs::Config::HorizontalAnchor::Center);
+                        output->setVerticalAnchor(bd::Outputs::Config::VerticalAnchor::Below);
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            previous = output->identifier();
+            identifiers.append(output->identifier());
+            output_configs.append(output);
         }
+
+        if (primary.isEmpty()) primary = identifiers.first();
+
+        auto group = new Group();
+        group->setName(QString(best->name()).remove(QStringLiteral(" (Auto Generated)")).append(" (Auto Generated)"));
+        group->setOutputConfigs(output_configs);
+        group->setStoredIdentifiers(identifiers);
+        group->setStoredPrimaryOutputIdentifier(primary);
+        group->setAutoGenerated(true);
+
+        return QSharedPointer<Group>(group);
     }
 
     QSharedPointer<Group> State::createDefaultGroup() {
@@ -142,6 +858,9 @@ namespace bd::Config::Outputs {
             auto output_config = new Output();
             output_config->setDisabled(false);
             output_config->setIdentifier(head->getIdentifier());
+            output_config->setMake(head->make());
+            output_config->setModel(head->model());
+            output_config->setConnector(head->name());
             output_configs.append(QSharedPointer<Output>(output_config));
         }
 
@@ -149,10 +868,150 @@ namespace bd::Config::Outputs {
         group->setOutputConfigs(output_configs); // Add all of our new output configs
         group->setStoredIdentifiers(names_of_active_outputs); // Add all of our new output identifiers
         group->setStoredPrimaryOutputIdentifier(names_of_active_outputs.first()); // Set our primary output identifier to the first one
+        group->setAutoGenerated(true); // Subject to the retention preferences
 
         return QSharedPointer<Group>(group);
     }
 
+    int State::compact() {
+        auto max_count = m_preferences->maxAutoGeneratedGroups();
+        auto max_age_days = m_preferences->autoGeneratedGroupMaxAgeDays();
+        auto now = QDateTime::currentSecsSinceEpoch();
+
+        // Only groups we generated are candidates, anything set up by the user stays. So do the groups in use.
+        QList<QSharedPointer<Group>> candidates;
+        for (const auto& group : m_groups) {
+            if (!group->autoGenerated() || group == m_activeGroup || group == m_matchingGroup || m_system_baselines.contains(group)) continue;
+            candidates.append(group);
+        }
+
+        // Least recently used first. Groups from before usage tracking (last_used of 0) go first when there are too many, but are never
+        // dropped for their age, there is no telling how old they are.
+        std::stable_sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a->lastUsed() < b->lastUsed(); });
+
+        QList<QSharedPointer<Group>> removed;
+        auto auto_generated_count = candidates.size() + (m_activeGroup && m_activeGroup->autoGenerated() ? 1 : 0) +
+                                    (m_matchingGroup && m_matchingGroup != m_activeGroup && m_matchingGroup->autoGenerated() ? 1 : 0);
+        for (const auto& group : candidates) {
+            bool too_old = max_age_days > 0 && group->lastUsed() > 0 && now - group->lastUsed() > static_cast<qint64>(max_age_days) * 24 * 60 * 60;
+            bool too_many = max_count > 0 && auto_generated_count > max_count;
+            if (!too_old && !too_many) continue;
+
+            removed.append(group);
+            auto_generated_count--;
+        }
+
+        if (removed.isEmpty()) return 0;
+
+        for (const auto& group : removed) {
+            qDebug() << "Dropping auto generated group" << group->name() << "last used" << group->lastUsed();
+            m_groups.removeOne(group);
+        }
+        rebuildGroupIndex();
+
+        qInfo() << "Compacted display config, removed" << removed.size() << "auto generated groups";
+        return removed.size();
+    }
+
+    QList<QSharedPointer<Group>> State::compatibleGroups() {
+        if (m_group_index_dirty) rebuildGroupIndex();
+
+        auto key = currentIdentifierKey();
+        if (key.isEmpty()) return QList<QSharedPointer<Group>>();
+        return m_group_index.value(key);
+    }
+
+    bool State::activateGroup(const QString& name) {
+        QSharedPointer<Group> group;
+        for (const auto& candidate : compatibleGroups()) {
+            if (candidate->name() == name) {
+                group = candidate;
+                break;
+            }
+        }
+
+        if (!group) {
+            qWarning() << "No group named" << name << "matches the connected outputs";
+            return false;
+        }
+
+        qDebug() << "Switching to group" << name;
+        group->markUsed();
+        group->apply(planFor(group));
+
+        m_matchingGroup = group;
+        setActiveGroup(group);
+        return true;
+    }
+
+    void State::dropStalePlans() {
+        // Plans are only good for the outputs they were calculated against. Groups spell out everything they configure, so how the
+        // heads happen to be set up right now doesn't matter.
+        auto key = currentIdentifierKey();
+        if (key != m_plans_key) {
+            m_plans.clear();
+            m_plans_key = key;
+        }
+    }
+
+    void State::precomputePlans() {
+        dropStalePlans();
+        for (const auto& group : compatibleGroups()) planFor(group);
+    }
+
+    QSharedPointer<bd::Outputs::Config::Result> State::planFor(const QSharedPointer<Group>& group) {
+        auto manager = bd::Outputs::State::instance().getManager();
+        if (manager.isNull()) return QSharedPointer<bd::Outputs::Config::Result>(nullptr);
+
+        dropStalePlans();
+
+        auto fingerprint = QCryptographicHash::hash(effectiveConfig(group), QCryptographicHash::Sha1);
+        auto existing = m_plans.value(group);
+        if (existing.result && existing.fingerprint == fingerprint) return existing.result;
+
+        // Calculate on a scratch model, same as a client previewing a batch
+        bd::Outputs::Config::Model model;
+        for (const auto& action : group->actions()) model.addAction(action);
+        model.calculate();
+
+        auto result = model.getCalculationResult();
+        m_plans.insert(group, Plan {fingerprint, result});
+        qDebug() << "Calculated plan for group" << group->name();
+        return result;
+    }
+
+    QByteArray State::effectiveConfig(const QSharedPointer<Group>& group) {
+        QByteArray config;
+        bd::Config::TomlEmitter emitter(config);
+        group->writeToml(emitter, false);
+        return config;
+    }
+
+    QByteArray State::currentIdentifierKey() {
+        auto manager = bd::Outputs::State::instance().getManager();
+        if (manager.isNull()) return QByteArray();
+
+        QStringList identifiers;
+        for (const auto& head : manager->getHeads()) {
+            if (head->getIdentifier().isEmpty()) return QByteArray();
+            identifiers.append(head->getIdentifier());
+        }
+        return Group::identifierKey(identifiers);
+    }
+
+    void State::rebuildGroupIndex() {
+        m_group_index.clear();
+        // Groups may have been replaced or removed, plans for them are recalculated on demand
+        m_plans.clear();
+        for (const auto& group : m_groups) {
+            m_group_index[Group::identifierKey(group->storedIdentifiers())].append(group);
+
+            // Identifiers of a group can be edited in place, drop the index when that happens
+            connect(group.data(), &Group::storedIdentifiersChanged, this, [this]() { m_group_index_dirty = true; }, Qt::UniqueConnection);
+        }
+        m_group_index_dirty = false;
+    }
+
     QSharedPointer<Group> State::getMatchingGroup() {
         QSharedPointer<Group> matching_group = QSharedPointer<Group>(nullptr);
         auto &orchestrator = bd::Outputs::State::instance();
@@ -162,43 +1021,23 @@ namespace bd::Config::Outputs {
             return matching_group;
         }
 
+        if (m_group_index_dirty) rebuildGroupIndex();
+
         // Find any matching group
         auto heads = manager->getHeads();
-        auto heads_size = heads.size();
-
-        qDebug() << "Found" << heads_size << "heads";
+        qDebug() << "Found" << heads.size() << "heads";
 
-        auto matching_groups = QList<QSharedPointer<Group>>();
-        for (auto group : m_groups) {
-            if (group->storedIdentifiers().size() != heads_size) {
-                qDebug() << "Group" << group->name() << "has" << group->storedIdentifiers().size() << "identifiers, skipping";
-                continue;
-            }
-
-            bool match = true;
-            for (const auto& qIdentifier : group->storedIdentifiers()) {
-                qDebug() << "Checking if head" << qIdentifier << "is in group" << group->name();
-                bool found = false;
-                for (const auto& head : heads) {
-                    if (head->getIdentifier() == qIdentifier) {
-                        qDebug() << "Head" << qIdentifier << "found in group" << group->name();
-                        found = true;
-                        break;
-                    }
-                }
-
-                if (!found) {
-                    match = false;
-                    break;
-                }
-            }
-
-            if (match) {
-                qDebug() << "Group" << group->name() << "matches, adding to matching groups";
-                matching_groups.append(group);
+        QStringList identifiers;
+        for (const auto& head : heads) {
+            // A head we cannot identify can never be part of a stored group
+            if (head->getIdentifier().isEmpty()) {
+                qDebug() << "Head without an identifier, no group can match";
+                return matching_group;
             }
+            identifiers.append(head->getIdentifier());
         }
 
+        auto matching_groups = m_group_index.value(Group::identifierKey(identifiers));
         if (!matching_groups.isEmpty()) {
             qDebug() << "Found" << matching_groups.size() << "matching groups";
             for (const auto& group : matching_groups) {
@@ -1,10 +1,18 @@
 #pragma once
 
+#include <QByteArray>
+#include <QFileSystemWatcher>
+#include <QHash>
 #include <QObject>
 #include <QSharedPointer>
+#include <QTimer>
 
+#include "cache.hpp"
 #include "group.hpp"
 #include "global_preferences.hpp"
+#include "history.hpp"
+#include "runtime_state.hpp"
+#include "config/writer.hpp"
 
 namespace bd::Config::Outputs {
     class State : public QObject {
@@ -31,10 +39,29 @@ namespace bd::Config::Outputs {
         void setMatchingGroup(QSharedPointer<Group> MatchingGroup);
         void setGroups(const QList<QSharedPointer<Group>>& Groups);
 
+        // Groups stored for exactly the outputs that are connected right now
+        QList<QSharedPointer<Group>> compatibleGroups();
+        // Switches to the compatible group with the given name using its precalculated plan, false if there is no such group
+        bool activateGroup(const QString& name);
+
+        // Reads the config and the system configs on disk afresh and returns every problem found, without touching the loaded state
+        QList<bd::Outputs::ConfigDiagnostic> lint() const;
+
+        // Earlier versions of the config, newest first. Entry n - 1 is what undo(n) goes back to.
+        QList<History::Entry> history() const;
+        // Restores the config as it was n versions ago and applies it, false if there is no such version
+        bool undo(qsizetype n);
+
     public Q_SLOTS:
         void apply();
         void deserialize();
+        // Schedules a write; bursts of calls are coalesced into a single write once things settle
         void save();
+        // Writes any pending changes right away and waits for them to hit the disk
+        void flush();
+        // Follows the heads of the active group in shim mode. Goes to the runtime state file rather than the config, shortly after the
+        // last call.
+        void recordRuntimeState();
 
     Q_SIGNALS:
         void activeGroupChanged(QSharedPointer<Group> ActiveGroup);
@@ -42,13 +69,88 @@ namespace bd::Config::Outputs {
         void saved();
 
 
+    private Q_SLOTS:
+        // Calculates the plan of every compatible group ahead of time, so switching between them is a single apply
+        void precomputePlans();
+        void reload();
+        // Returns whether the write added a version to the history
+        bool writeNow();
+        void storeRuntimeState();
+        void onWritten(const QString& path, const QByteArray& data, bool success);
+
     private:
         QSharedPointer<Group> createDefaultGroup();
+        // Derives a group for the current outputs from the closest stored one, null if nothing is close enough
+        QSharedPointer<Group> createAdaptedGroup();
         QSharedPointer<Group> getMatchingGroup();
+        void rebuildGroupIndex();
+        QByteArray currentIdentifierKey();
+        // Clears the plans once the outputs moved on from what they were calculated against
+        void dropStalePlans();
+        // What a group configures, without usage bookkeeping, for telling whether two versions of a group differ
+        static QByteArray effectiveConfig(const QSharedPointer<Group>& group);
+        QSharedPointer<bd::Outputs::Config::Result> planFor(const QSharedPointer<Group>& group);
+        QString configPath() const;
+        // Fleet wide configs in $XDG_CONFIG_DIRS, least important first
+        QStringList systemConfigPaths() const;
+        // Reads and merges the system wide configs into m_system_groups and m_system_preferences, unless they are the same as last
+        // time. Returns whether they changed.
+        bool loadSystemLayer();
+        // Makes the given user groups, followed by the system groups they don't override by name, the effective groups
+        void setUserGroups(const QList<QSharedPointer<Group>>& groups);
+        // What belongs in the user config: everything but the system groups that are still as shipped
+        QList<QSharedPointer<Group>> userGroups() const;
+        QByteArray serialize(bool includeUsage = true) const;
+        // Bad groups and outputs are skipped and reported in diagnostics, only a file that isn't valid TOML at all throws
+        void parse(const toml::value& data, QList<QSharedPointer<Group>>& groups, GlobalPreferences& preferences,
+                   QList<bd::Outputs::ConfigDiagnostic>& diagnostics) const;
+        // Logs diagnostics, and backs up the file they came from if anything had to be skipped
+        void report(const QByteArray& content, const QList<bd::Outputs::ConfigDiagnostic>& diagnostics);
+        // Drops auto generated groups per the retention preferences, returns how many were removed
+        int compact();
+        void watch();
+        // Modification time and size of the config, {-1, -1} if there is none
+        QPair<qint64, qint64> configStamp() const;
+        void storeCache(const QByteArray& toml, qint64 mtime);
+        // Adds the current config to the history if it differs from the newest version in there, returns whether it did
+        bool recordHistory();
 
         QSharedPointer<GlobalPreferences> m_preferences;
         QSharedPointer<Group> m_activeGroup;
         QSharedPointer<Group> m_matchingGroup;
         QList<QSharedPointer<Group>> m_groups;
+        // Groups by Group::identifierKey of their stored identifiers, in m_groups order
+        QHash<QByteArray, QList<QSharedPointer<Group>>> m_group_index;
+        bool m_group_index_dirty;
+
+        struct Plan {
+            // Hash of what the group configures when the plan was calculated, a group edited since gets a new plan
+            QByteArray fingerprint;
+            QSharedPointer<bd::Outputs::Config::Result> result;
+        };
+        QHash<QSharedPointer<Group>, Plan> m_plans;
+        // Identifier key of the outputs the plans were calculated against
+        QByteArray m_plans_key;
+
+        QTimer *m_save_timer;
+        QTimer *m_reload_timer;
+        QTimer *m_runtime_timer;
+        QTimer *m_plans_timer;
+        QFileSystemWatcher *m_watcher;
+        bd::Config::Writer *m_writer;
+        // What is on disk (or on its way there), so unchanged configs are not rewritten
+        QByteArray m_last_saved;
+        // Writes of the config still on their way to the disk, reloads wait for them
+        int m_pending_writes = 0;
+        // Modification time and size of the config when last looked at, see configStamp
+        QPair<qint64, qint64> m_config_stamp {-1, -1};
+        History m_history;
+        // System groups in effect, with what each configured as shipped. They only make it into the user config once changed.
+        QList<QSharedPointer<Group>> m_system_groups;
+        QHash<QSharedPointer<Group>, QByteArray> m_system_baselines;
+        GlobalPreferences m_system_preferences;
+        // Everything read from the system configs, to tell whether they changed and to key the cache on
+        QByteArray m_system_content;
+        RuntimeState m_runtime_state;
     };
 }
\ No newline at end of file
@@ -9,18 +9,51 @@ void bd::ConfigUtils::ensureConfigPathExists(const fs::path& p) {
   if (!fs::exists(dir)) { fs::create_directories(dir); }
 }
 
+namespace {
+  // $<env>/budgie-desktop/<name>, or ~/<fallback>/budgie-desktop/<name> when the variable is unset, per the XDG base directory spec
+  fs::path xdgPath(const char* env, const char* fallback, const std::string& name) {
+    const char* base = std::getenv(env);
+    fs::path    path {};
+    if (base) path /= base;
+    if (base == nullptr) {
+      const char* home = std::getenv("HOME");
+      if (!home) { qFatal("HOME environment variable not set"); }
+      path /= home;
+      path /= fallback;
+    }
+
+    path /= "budgie-desktop";
+    path /= name;
+    return path;
+  }
+}  // namespace
+
 fs::path bd::ConfigUtils::getConfigPath(const std::string& config_name) {
-  const char* xdg_config_home = std::getenv("XDG_CONFIG_HOME");
-  fs::path    path {};
-  if (xdg_config_home) path /= xdg_config_home;
-  if (xdg_config_home == nullptr) {
-    const char* home = std::getenv("HOME");
-    if (!home) { qFatal("HOME environment variable not set"); }
-    path /= home;
-    path /= ".config";
+  return xdgPath("XDG_CONFIG_HOME", ".config", config_name);
+}
+
+std::vector<fs::path> bd::ConfigUtils::getSystemConfigPaths(const std::string& config_name) {
+  const char* xdg_config_dirs = std::getenv("XDG_CONFIG_DIRS");
+  std::string dirs = (xdg_config_dirs && *xdg_config_dirs) ? xdg_config_dirs : "/etc/xdg";
+
+  // The spec lists the most important directory first
+  std::vector<fs::path> paths {};
+  std::string::size_type start = 0;
+  while (start <= dirs.size()) {
+    auto end = dirs.find(':', start);
+    if (end == std::string::npos) end = dirs.size();
+    // Relative entries are invalid per the spec and are ignored
+    auto dir = dirs.substr(start, end - start);
+    if (!dir.empty() && dir.front() == '/') paths.insert(paths.begin(), fs::path(dir) / "budgie-desktop" / config_name);
+    start = end + 1;
   }
+  return paths;
+}
+
+fs::path bd::ConfigUtils::getCachePath(const std::string& cache_name) {
+  return xdgPath("XDG_CACHE_HOME", ".cache", cache_name);
+}
 
-  path /= "budgie-desktop";
-  path /= config_name;
-  return path;
+fs::path bd::ConfigUtils::getStatePath(const std::string& state_name) {
+  return xdgPath("XDG_STATE_HOME", ".local/state", state_name);
 }
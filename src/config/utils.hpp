@@ -3,8 +3,15 @@
 #include <filesystem>
 #include <string>
 #include <toml.hpp>
+#include <vector>
 
 namespace bd::ConfigUtils {
   void                  ensureConfigPathExists(const std::filesystem::path& p);
   std::filesystem::path getConfigPath(const std::string& config_name);
+  // <dir>/budgie-desktop for every directory in $XDG_CONFIG_DIRS (/etc/xdg if unset), least important first so later ones win
+  std::vector<std::filesystem::path> getSystemConfigPaths(const std::string& config_name);
+  // $XDG_CACHE_HOME/budgie-desktop, for data that can be regenerated at any time
+  std::filesystem::path getCachePath(const std::string& cache_name);
+  // $XDG_STATE_HOME/budgie-desktop, for data worth keeping across restarts that isn't configuration
+  std::filesystem::path getStatePath(const std::string& state_name);
 }
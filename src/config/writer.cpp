@@ -0,0 +1,69 @@
+#include "writer.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtLogging>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace bd::Config {
+  Writer::Writer(QObject* parent) : QObject(parent) {
+    m_pool.setMaxThreadCount(1);
+  }
+
+  Writer::~Writer() {
+    m_pool.waitForDone();
+  }
+
+  void Writer::write(const QString& path, const QByteArray& data) {
+    m_pool.start([this, path, data]() {
+      auto success = writeAtomically(path, data);
+      emit written(path, data, success);
+    });
+  }
+
+  void Writer::waitForDone() {
+    m_pool.waitForDone();
+  }
+
+  bool Writer::writeAtomically(const QString& path, const QByteArray& data) {
+    auto info    = QFileInfo(path);
+    auto dirPath = info.absolutePath();
+    QDir().mkpath(dirPath);
+
+    // Same directory as the target, so the rename below cannot cross file systems
+    auto tempPath = QString("%1/.%2.tmp").arg(dirPath, info.fileName());
+    auto tempFile = QFile(tempPath);
+    if (!tempFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      qWarning() << "Failed to open" << tempPath << "for writing:" << tempFile.errorString();
+      return false;
+    }
+
+    if (tempFile.write(data) != data.size() || !tempFile.flush() || fsync(tempFile.handle()) != 0) {
+      qWarning() << "Failed to write" << tempPath << ":" << tempFile.errorString();
+      tempFile.close();
+      tempFile.remove();
+      return false;
+    }
+    tempFile.close();
+
+    if (std::rename(QFile::encodeName(tempPath).constData(), QFile::encodeName(path).constData()) != 0) {
+      qWarning() << "Failed to move" << tempPath << "to" << path << ":" << std::strerror(errno);
+      QFile::remove(tempPath);
+      return false;
+    }
+
+    // Make the rename itself durable
+    auto dirFd = open(QFile::encodeName(dirPath).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+      fsync(dirFd);
+      close(dirFd);
+    }
+    return true;
+  }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+namespace bd::Config {
+  // Writes config files off the event loop. Writes are atomic (temp file, fsync, rename, directory fsync) and run one at a time in the
+  // order they were queued, so a later write can never be overtaken by an earlier one.
+  class Writer : public QObject {
+      Q_OBJECT
+
+    public:
+      explicit Writer(QObject* parent = nullptr);
+      ~Writer() override;
+
+      void write(const QString& path, const QByteArray& data);
+
+      // Blocks until every queued write has hit the disk
+      void waitForDone();
+
+      static bool writeAtomically(const QString& path, const QByteArray& data);
+
+    Q_SIGNALS:
+      // Emitted from the writer thread
+      void written(const QString& path, const QByteArray& data, bool success);
+
+    private:
+      QThreadPool m_pool;
+  };
+}
@@ -1,7 +1,11 @@
 #include "ConfigService.hpp"
 
 #include <QDBusConnection>
+#include <QDBusMessage>
 
+#include "ObjectManager.hpp"
+#include "PeerServer.hpp"
+#include "config/outputs/state.hpp"
 #include "outputs/config/action.hpp"
 #include "outputs/config/enums/actiontype.hpp"
 #include "outputs/config/model.hpp"
@@ -9,25 +13,63 @@
 
 namespace bd {
   ConfigService::ConfigService(QObject* parent) : QObject(parent) {
-    if (!QDBusConnection::sessionBus().registerObject(OUTPUT_CONFIG_SERVICE_PATH, this, QDBusConnection::ExportAllContents)) {
+    if (!PeerServer::instance().registerObject(OUTPUT_CONFIG_SERVICE_PATH, this)) {
       qCritical() << "Failed to register DBus object at path" << OUTPUT_CONFIG_SERVICE_PATH;
+    } else {
+      ObjectManager::instance().objectAdded(OUTPUT_CONFIG_SERVICE_PATH, this);
     }
 
     connect(&bd::Outputs::Config::Model::instance(), &bd::Outputs::Config::Model::configurationApplied, this, &ConfigService::ConfigurationApplied);
+    connect(&bd::Outputs::Config::Model::instance(), &bd::Outputs::Config::Model::configurationOutcome, this, &ConfigService::ConfigurationOutcome);
+    connect(&bd::Config::Outputs::State::instance(), &bd::Config::Outputs::State::activeGroupChanged, this,
+            [this](QSharedPointer<bd::Config::Outputs::Group> group) { emit ActiveGroupChanged(group ? group->name() : QString()); });
+
+    // Drop a client's session as soon as its bus name goes away (NameOwnerChanged with an empty new owner)
+    m_session_watcher = new QDBusServiceWatcher(this);
+    m_session_watcher->setConnection(QDBusConnection::sessionBus());
+    m_session_watcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+    connect(m_session_watcher, &QDBusServiceWatcher::serviceUnregistered, this, &ConfigService::onClientVanished);
+
+    // Peer sessions are keyed on the connection name and go with the connection
+    connect(&PeerServer::instance(), &PeerServer::peerDisconnected, this, &ConfigService::onClientVanished);
+  }
+
+  bd::Outputs::Config::Model& ConfigService::session() {
+    // Calls made from within the daemon share a single session keyed on the empty name
+    auto sender  = QString();
+    auto fromBus = false;
+    if (calledFromDBus()) {
+      // Peers on the private endpoint have no bus name, use their connection instead
+      fromBus = connection().name() == QDBusConnection::sessionBus().name();
+      sender  = fromBus ? message().service() : connection().name();
+    }
+
+    auto existing = m_sessions.value(sender);
+    if (existing) return *existing;
+
+    auto model = QSharedPointer<bd::Outputs::Config::Model>::create();
+    m_sessions.insert(sender, model);
+    if (fromBus) m_session_watcher->addWatchedService(sender);
+    return *model;
+  }
+
+  void ConfigService::onClientVanished(const QString& service) {
+    if (m_session_watcher->watchedServices().contains(service)) m_session_watcher->removeWatchedService(service);
+    if (m_sessions.remove(service) > 0) qDebug() << "Dropped configuration session for" << service;
   }
 
   void ConfigService::ResetConfiguration() {
-    bd::Outputs::Config::Model::instance().reset();
+    session().reset();
   }
 
   void ConfigService::SetOutputEnabled(const QString& serial, bool enabled) {
     auto action = enabled ? bd::Outputs::Config::Action::explicitOn(serial) : bd::Outputs::Config::Action::explicitOff(serial);
-    bd::Outputs::Config::Model::instance().addAction(action);
+    session().addAction(action);
   }
 
   void ConfigService::SetOutputMode(const QString& serial, int width, int height, qulonglong refreshRate) {
     auto action = bd::Outputs::Config::Action::mode(serial, QSize(width, height), refreshRate);
-    bd::Outputs::Config::Model::instance().addAction(action);
+    session().addAction(action);
   }
 
   void
@@ -35,88 +77,142 @@ namespace bd {
     auto hAnchor = bd::Outputs::Config::HorizontalAnchor::fromString(horizontalAnchor);
     auto vAnchor = bd::Outputs::Config::VerticalAnchor::fromString(verticalAnchor);
     auto action  = bd::Outputs::Config::Action::positionAnchor(serial, relativeSerial, hAnchor, vAnchor);
-    bd::Outputs::Config::Model::instance().addAction(action);
+    session().addAction(action);
   }
 
   void ConfigService::SetOutputScale(const QString& serial, double scale) {
     auto action = bd::Outputs::Config::Action::scale(serial, scale);
-    bd::Outputs::Config::Model::instance().addAction(action);
+    session().addAction(action);
   }
 
   void ConfigService::SetOutputTransform(const QString& serial, quint16 transform) {
     auto action = bd::Outputs::Config::Action::transform(serial, static_cast<quint16>(transform));
-    bd::Outputs::Config::Model::instance().addAction(action);
+    session().addAction(action);
   }
 
   void ConfigService::SetOutputAdaptiveSync(const QString& serial, uint adaptiveSync) {
     auto action = bd::Outputs::Config::Action::adaptiveSync(serial, static_cast<uint32_t>(adaptiveSync));
-    bd::Outputs::Config::Model::instance().addAction(action);
+    session().addAction(action);
   }
 
   void ConfigService::SetOutputPrimary(const QString& serial) {
     auto action = bd::Outputs::Config::Action::primary(serial);
-    bd::Outputs::Config::Model::instance().addAction(action);
+    session().addAction(action);
   }
 
   void ConfigService::SetOutputMirrorOf(const QString& serial, const QString& mirrorSerial) {
     auto action = bd::Outputs::Config::Action::mirrorOf(serial, mirrorSerial);
-    bd::Outputs::Config::Model::instance().addAction(action);
+    session().addAction(action);
   }
 
   QVariantMap ConfigService::CalculateConfiguration() {
-    bd::Outputs::Config::Model::instance().calculate();
-    auto result = bd::Outputs::Config::Model::instance().getCalculationResult();
+    auto& model = session();
+    model.calculate();
+    auto result = model.getCalculationResult();
     if (result) { return result->toVariantMap(); }
     return QVariantMap {};
   }
 
   bool ConfigService::ApplyConfiguration() {
-    bd::Outputs::Config::Model::instance().apply();
+    // Only the apply is serialized; the batch is handed over as a whole and the session keeps its actions
+    bd::Outputs::Config::Model::instance().submit(session().getActions());
     // The result will be emitted via ConfigurationApplied signal
     return true;
   }
 
   QVariantList ConfigService::GetActions() {
     QVariantList result;
-    auto         actions = bd::Outputs::Config::Model::instance().getActions();
-    for (const auto& action : actions) {
-      QVariantMap map;
-      map["type"]   = bd::Outputs::Config::ActionType::toString(action->getActionType());
-      map["serial"] = action->getSerial();
-      switch (action->getActionType()) {
-        case bd::Outputs::Config::ActionType::Type::SetOnOff:
-          map["on"] = action->isOn();
-          break;
-        case bd::Outputs::Config::ActionType::Type::SetMode:
-          map["dimensions"] = QVariant::fromValue(action->getDimensions());
-          map["refresh"]    = action->getRefresh();
-          break;
-        case bd::Outputs::Config::ActionType::Type::SetPositionAnchor:
-          map["relative"]         = action->getRelative();
-          map["horizontalAnchor"] = bd::Outputs::Config::HorizontalAnchor::toString(action->getHorizontalAnchor());
-          map["verticalAnchor"]   = bd::Outputs::Config::VerticalAnchor::toString(action->getVerticalAnchor());
-          break;
-        case bd::Outputs::Config::ActionType::Type::SetScale:
-          map["scale"] = action->getScale();
-          break;
-        case bd::Outputs::Config::ActionType::Type::SetTransform:
-          map["transform"] = action->getTransform();
-          break;
-        case bd::Outputs::Config::ActionType::Type::SetAdaptiveSync:
-          map["adaptiveSync"] = action->getAdaptiveSync();
-          break;
-        case bd::Outputs::Config::ActionType::Type::SetPrimary:
-          // No extra fields
-          break;
-        case bd::Outputs::Config::ActionType::Type::SetMirrorOf:
-          map["relative"] = action->getRelative();
-          break;
-        default:
-          break;
-      }
-      result << map;
-    }
+    auto         actions = session().getActions();
+    for (const auto& action : actions) { result << action->toVariantMap(); }
+    return result;
+  }
+
+  bd::Outputs::CalculationResultInfo ConfigService::CalculateConfigurationTyped() {
+    auto& model = session();
+    model.calculate();
+    auto result = model.getCalculationResult();
+    if (result) { return result->toDBusStruct(); }
+    return bd::Outputs::CalculationResultInfo {};
+  }
+
+  QList<bd::Outputs::ActionInfo> ConfigService::GetActionsTyped() {
+    QList<bd::Outputs::ActionInfo> result;
+    auto                           actions = session().getActions();
+    for (const auto& action : actions) { result << action->toDBusStruct(); }
     return result;
   }
 
+  QStringList ConfigService::ListCompatibleGroups() {
+    QStringList names;
+    for (const auto& group : bd::Config::Outputs::State::instance().compatibleGroups()) { names << group->name(); }
+    return names;
+  }
+
+  QString ConfigService::GetActiveGroup() {
+    auto group = bd::Config::Outputs::State::instance().activeGroup();
+    return group ? group->name() : QString();
+  }
+
+  bool ConfigService::SetActiveGroup(const QString& name) {
+    if (bd::Config::Outputs::State::instance().activateGroup(name)) return true;
+
+    if (calledFromDBus()) sendErrorReply(QDBusError::InvalidArgs, QString("No group named %1 matches the connected outputs").arg(name));
+    return false;
+  }
+
+  QList<bd::Outputs::ConfigDiagnostic> ConfigService::LintConfiguration() {
+    return bd::Config::Outputs::State::instance().lint();
+  }
+
+  QList<bd::Outputs::HistoryEntryInfo> ConfigService::ListHistory() {
+    QList<bd::Outputs::HistoryEntryInfo> entries;
+    auto history = bd::Config::Outputs::State::instance().history();
+    for (qsizetype i = 0; i < history.size(); i++) {
+      entries.append({static_cast<uint>(i + 1), history.at(i).savedAt, history.at(i).summary});
+    }
+    return entries;
+  }
+
+  bool ConfigService::Undo(uint steps) {
+    if (bd::Config::Outputs::State::instance().undo(steps)) return true;
+
+    if (calledFromDBus()) sendErrorReply(QDBusError::InvalidArgs, QString("No display config %1 versions back").arg(steps));
+    return false;
+  }
+
+  bool ConfigService::ApplyActions(const QList<QVariantMap>& actions) {
+    QList<QSharedPointer<bd::Outputs::Config::Action>> batch;
+    if (!parseActions(actions, batch)) return false;
+
+    bd::Outputs::Config::Model::instance().submit(batch);
+    // The result will be emitted via ConfigurationApplied signal
+    return true;
+  }
+
+  QVariantMap ConfigService::CalculateActions(const QList<QVariantMap>& actions) {
+    QList<QSharedPointer<bd::Outputs::Config::Action>> batch;
+    if (!parseActions(actions, batch)) return QVariantMap {};
+
+    // Calculate on a scratch model so the shared batch stays untouched
+    bd::Outputs::Config::Model model;
+    for (const auto& action : batch) { model.addAction(action); }
+    model.calculate();
+    auto result = model.getCalculationResult();
+    if (result) { return result->toVariantMap(); }
+    return QVariantMap {};
+  }
+
+  bool ConfigService::parseActions(const QList<QVariantMap>& actions, QList<QSharedPointer<bd::Outputs::Config::Action>>& batch) {
+    for (const auto& map : actions) {
+      QString error;
+      auto    action = bd::Outputs::Config::Action::fromVariantMap(map, &error);
+      if (!action) {
+        qWarning() << "Rejecting action batch:" << error;
+        if (calledFromDBus()) sendErrorReply(QDBusError::InvalidArgs, error);
+        return false;
+      }
+      batch.append(action);
+    }
+    return true;
+  }
 }  // namespace bd
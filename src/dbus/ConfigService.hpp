@@ -1,7 +1,13 @@
 #pragma once
 
 #include <QDBusContext>
+#include <QDBusServiceWatcher>
+#include <QHash>
 #include <QObject>
+#include <QSharedPointer>
+
+#include "outputs/config/action.hpp"
+#include "outputs/config/model.hpp"
 
 #define OUTPUT_CONFIG_SERVICE_PATH "/org/buddiesofbudgie/Services/Outputs/Config"
 
@@ -27,8 +33,38 @@ namespace bd {
       QVariantMap CalculateConfiguration();
       bool        ApplyConfiguration();
       QVariantList GetActions();
+      // Atomic alternatives to ResetConfiguration + Set* + Apply/CalculateConfiguration, taking the whole batch as a list of GetActions-style maps
+      bool        ApplyActions(const QList<QVariantMap>& actions);
+      QVariantMap CalculateActions(const QList<QVariantMap>& actions);
+      // Typed variants of CalculateConfiguration and GetActions, no nested variants to marshal or unpack
+      bd::Outputs::CalculationResultInfo CalculateConfigurationTyped();
+      QList<bd::Outputs::ActionInfo>     GetActionsTyped();
+      // Stored groups for the connected outputs, and switching between them. Switches use plans calculated ahead of time.
+      QStringList ListCompatibleGroups();
+      QString     GetActiveGroup();
+      bool        SetActiveGroup(const QString& name);
+      // Problems in the display config on disk, as (severity, location, message)
+      QList<bd::Outputs::ConfigDiagnostic> LintConfiguration();
+      // Earlier versions of the display config, newest first as (index, saved at, summary), and going back to one of them
+      QList<bd::Outputs::HistoryEntryInfo> ListHistory();
+      bool                                 Undo(uint steps);
 
     Q_SIGNALS:
       void ConfigurationApplied(bool success);
+      // Which heads changed or were left alone, how long the compositor took, cancellation and custom mode fallbacks
+      void ConfigurationOutcome(const bd::Outputs::ApplyOutcome& outcome);
+      void ActiveGroupChanged(const QString& name);
+
+    private Q_SLOTS:
+      void onClientVanished(const QString& service);
+
+    private:
+      // Each D-Bus client builds its batch in its own session, so clients never see or clobber each other's actions
+      bd::Outputs::Config::Model& session();
+
+      QHash<QString, QSharedPointer<bd::Outputs::Config::Model>> m_sessions;
+      QDBusServiceWatcher*                                       m_session_watcher;
+
+      bool parseActions(const QList<QVariantMap>& actions, QList<QSharedPointer<bd::Outputs::Config::Action>>& batch);
   };
 }
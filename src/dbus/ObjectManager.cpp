@@ -0,0 +1,77 @@
+#include "ObjectManager.hpp"
+
+#include <QDBusConnection>
+#include <QMetaClassInfo>
+#include <QMetaProperty>
+
+#include "PeerServer.hpp"
+
+namespace bd {
+  ObjectManager::ObjectManager(QObject* parent)
+      : QObject(parent), m_objects(QMap<QString, QPointer<QObject>>()), m_interfaces(QMap<QString, QString>()) {}
+
+  ObjectManager& ObjectManager::instance() {
+    static ObjectManager _instance(nullptr);
+    return _instance;
+  }
+
+  void ObjectManager::registerDbusService() {
+    qInfo() << "Registering DBus object manager at path" << SERVICES_ROOT_PATH;
+    if (!PeerServer::instance().registerObject(SERVICES_ROOT_PATH, this)) {
+      qCritical() << "Failed to register DBus object at path" << SERVICES_ROOT_PATH;
+    }
+  }
+
+  void ObjectManager::objectAdded(const QString& path, QObject* object) {
+    if (!object) return;
+    auto interface = interfaceOf(object);
+    m_objects.insert(path, QPointer<QObject>(object));
+    m_interfaces.insert(path, interface);
+
+    bd::Outputs::NestedKvMap interfaces;
+    interfaces.insert(interface, propertiesOf(object));
+    emit InterfacesAdded(QDBusObjectPath(path), interfaces);
+  }
+
+  void ObjectManager::objectRemoved(const QString& path) {
+    if (!m_interfaces.contains(path)) return;
+
+    // The object may already be gone, so use the interface we recorded when it was added
+    m_objects.remove(path);
+    auto interface = m_interfaces.take(path);
+    emit InterfacesRemoved(QDBusObjectPath(path), QStringList {interface});
+  }
+
+  QString ObjectManager::interfaceOf(const QObject* object) {
+    if (!object) return QString();
+    auto meta  = object->metaObject();
+    auto index = meta->indexOfClassInfo("D-Bus Interface");
+    if (index < 0) return QString();
+    return QString::fromLatin1(meta->classInfo(index).value());
+  }
+
+  QVariantMap ObjectManager::propertiesOf(const QObject* object) {
+    QVariantMap properties;
+    if (!object) return properties;
+
+    // Skip QObject's own properties (objectName), these are not part of our D-Bus interfaces
+    auto meta = object->metaObject();
+    for (int i = QObject::staticMetaObject.propertyCount(); i < meta->propertyCount(); ++i) {
+      auto property = meta->property(i);
+      if (!property.isReadable()) continue;
+      properties.insert(QString::fromLatin1(property.name()), property.read(object));
+    }
+    return properties;
+  }
+
+  bd::Outputs::ManagedObjectsMap ObjectManager::GetManagedObjects() {
+    bd::Outputs::ManagedObjectsMap objects;
+    for (auto it = m_objects.constBegin(); it != m_objects.constEnd(); ++it) {
+      if (!it.value()) continue;
+      bd::Outputs::NestedKvMap interfaces;
+      interfaces.insert(m_interfaces.value(it.key()), propertiesOf(it.value()));
+      objects.insert(QDBusObjectPath(it.key()), interfaces);
+    }
+    return objects;
+  }
+}
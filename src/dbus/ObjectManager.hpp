@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QDBusContext>
+#include <QDBusObjectPath>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+
+#include "outputs/types.hpp"
+
+#define SERVICES_ROOT_PATH "/org/buddiesofbudgie/Services"
+
+namespace bd {
+  // Implements org.freedesktop.DBus.ObjectManager on the services root, so clients can fetch every exported object with all of its properties in one call
+  // and follow hotplug through InterfacesAdded / InterfacesRemoved.
+  class ObjectManager : public QObject, protected QDBusContext {
+      Q_OBJECT
+      Q_CLASSINFO("D-Bus Interface", "org.freedesktop.DBus.ObjectManager")
+
+    public:
+      explicit ObjectManager(QObject* parent = nullptr);
+      static ObjectManager& instance();
+      static ObjectManager* create() { return &instance(); }
+
+      void registerDbusService();
+
+      // Called by exported objects once they are (un)registered on the bus
+      void objectAdded(const QString& path, QObject* object);
+      void objectRemoved(const QString& path);
+
+      static QString     interfaceOf(const QObject* object);
+      static QVariantMap propertiesOf(const QObject* object);
+
+    public Q_SLOTS:
+      bd::Outputs::ManagedObjectsMap GetManagedObjects();
+
+    Q_SIGNALS:
+      void InterfacesAdded(const QDBusObjectPath& path, const bd::Outputs::NestedKvMap& interfaces);
+      void InterfacesRemoved(const QDBusObjectPath& path, const QStringList& interfaces);
+
+    private:
+      QMap<QString, QPointer<QObject>> m_objects;
+      QMap<QString, QString>           m_interfaces;
+  };
+}
@@ -0,0 +1,154 @@
+#include "PeerServer.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <cerrno>
+#include <cstring>
+
+namespace bd {
+  namespace {
+    // Whether something accepts connections on the socket, i.e. it belongs to a running instance rather than a dead one
+    bool isSocketLive(const QString& path) {
+      auto encoded = QFile::encodeName(path);
+      sockaddr_un address {};
+      if (static_cast<size_t>(encoded.size()) >= sizeof(address.sun_path)) return false;
+      address.sun_family = AF_UNIX;
+      std::memcpy(address.sun_path, encoded.constData(), encoded.size());
+
+      // Non-blocking, so a busy instance can't stall our startup. On a full backlog connect fails with EAGAIN, someone is still listening.
+      auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+      if (fd < 0) return false;
+      auto connected = ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+      auto live = connected || errno == EAGAIN;
+      close(fd);
+      return live;
+    }
+  }  // namespace
+
+  PeerServer::PeerServer(QObject* parent)
+      : QObject(parent), m_server(nullptr), m_peers(QStringList()), m_registrations(QMap<QString, Registration>()) {
+    // QDBusServer does not tell us when a peer goes away, so check for closed connections now and then
+    m_prune_timer.setInterval(30000);
+    connect(&m_prune_timer, &QTimer::timeout, this, &PeerServer::prunePeers);
+  }
+
+  PeerServer& PeerServer::instance() {
+    static PeerServer _instance(nullptr);
+    return _instance;
+  }
+
+  bool PeerServer::start() {
+    if (m_server) return m_server->isConnected();
+
+    auto runtimeDir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (runtimeDir.isEmpty()) {
+      qWarning() << "No runtime directory, not starting the peer D-Bus endpoint";
+      return false;
+    }
+
+    // A socket left behind by a previous instance would make listening fail, one that still answers belongs to an instance that is running
+    auto socketPath = QDir(runtimeDir).filePath(PEER_SERVER_SOCKET_NAME);
+    if (QFile::exists(socketPath)) {
+      if (isSocketLive(socketPath)) {
+        qWarning() << "Another instance is serving the peer D-Bus endpoint at" << socketPath << ", not starting ours";
+        return false;
+      }
+      QFile::remove(socketPath);
+    }
+
+    m_server = new QDBusServer(QString("unix:path=%1").arg(socketPath), this);
+    if (!m_server->isConnected()) {
+      qWarning() << "Failed to start the peer D-Bus endpoint at" << socketPath << ":" << m_server->lastError().message();
+      return false;
+    }
+
+    connect(m_server, &QDBusServer::newConnection, this, &PeerServer::onNewConnection);
+    m_prune_timer.start();
+    qInfo() << "Peer D-Bus endpoint listening at" << m_server->address();
+    return true;
+  }
+
+  QString PeerServer::address() const {
+    if (!m_server) return QString();
+    return m_server->address();
+  }
+
+  bool PeerServer::registerOn(QDBusConnection connection, const QString& path, const Registration& registration) {
+    if (!registration.object) return false;
+    if (registration.isVirtual) {
+      return connection.registerVirtualObject(path, static_cast<QDBusVirtualObject*>(registration.object.data()), QDBusConnection::SubPath);
+    }
+    return connection.registerObject(path, registration.object, registration.options);
+  }
+
+  bool PeerServer::registerObject(const QString& path, QObject* object, QDBusConnection::RegisterOptions options) {
+    Registration registration {QPointer<QObject>(object), false, options};
+    if (!registerOn(QDBusConnection::sessionBus(), path, registration)) return false;
+
+    m_registrations.insert(path, registration);
+    for (const auto& peer : std::as_const(m_peers)) {
+      if (!registerOn(QDBusConnection(peer), path, registration)) qWarning() << "Failed to register" << path << "for peer" << peer;
+    }
+    return true;
+  }
+
+  bool PeerServer::registerVirtualObject(const QString& path, QDBusVirtualObject* object) {
+    Registration registration {QPointer<QObject>(object), true, QDBusConnection::ExportAllContents};
+    if (!registerOn(QDBusConnection::sessionBus(), path, registration)) return false;
+
+    m_registrations.insert(path, registration);
+    for (const auto& peer : std::as_const(m_peers)) {
+      if (!registerOn(QDBusConnection(peer), path, registration)) qWarning() << "Failed to register" << path << "for peer" << peer;
+    }
+    return true;
+  }
+
+  void PeerServer::unregisterObject(const QString& path, QDBusConnection::UnregisterMode mode) {
+    QDBusConnection::sessionBus().unregisterObject(path, mode);
+    for (const auto& peer : std::as_const(m_peers)) { QDBusConnection(peer).unregisterObject(path, mode); }
+
+    // Mirror what the connections just dropped, so it is not replayed for new peers
+    m_registrations.remove(path);
+    if (mode == QDBusConnection::UnregisterTree) {
+      auto prefix = path + '/';
+      for (auto it = m_registrations.begin(); it != m_registrations.end();) {
+        it = it.key().startsWith(prefix) ? m_registrations.erase(it) : std::next(it);
+      }
+    }
+  }
+
+  void PeerServer::send(const QDBusMessage& message) {
+    QDBusConnection::sessionBus().send(message);
+    for (const auto& peer : std::as_const(m_peers)) { QDBusConnection(peer).send(message); }
+  }
+
+  void PeerServer::onNewConnection(const QDBusConnection& connection) {
+    qDebug() << "Peer connected:" << connection.name();
+    m_peers.append(connection.name());
+
+    // Replay everything currently exported, parents before children as QMap keeps paths sorted
+    for (auto it = m_registrations.constBegin(); it != m_registrations.constEnd(); ++it) {
+      if (!registerOn(connection, it.key(), it.value())) qWarning() << "Failed to register" << it.key() << "for peer" << connection.name();
+    }
+  }
+
+  void PeerServer::prunePeers() {
+    for (auto it = m_peers.begin(); it != m_peers.end();) {
+      if (QDBusConnection(*it).isConnected()) {
+        ++it;
+        continue;
+      }
+
+      auto name = *it;
+      it        = m_peers.erase(it);
+      qDebug() << "Peer disconnected:" << name;
+      QDBusConnection::disconnectFromPeer(name);
+      emit peerDisconnected(name);
+    }
+  }
+}
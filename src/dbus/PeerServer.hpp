@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusServer>
+#include <QDBusVirtualObject>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QTimer>
+
+#define PEER_SERVER_SOCKET_NAME "budgie-desktop-services"
+
+namespace bd {
+  // Serves our objects on a private socket in $XDG_RUNTIME_DIR alongside the session bus, so trusted session components (compositor helpers,
+  // panel) can talk to us directly without going through the bus daemon.
+  //
+  // Every object registration goes through here: it lands on the session bus and every peer connection, and is replayed for peers connecting
+  // later. Qt relays signals of exported objects on each connection they are registered on; hand-built signals must be sent through send().
+  class PeerServer : public QObject {
+      Q_OBJECT
+
+    public:
+      explicit PeerServer(QObject* parent = nullptr);
+      static PeerServer& instance();
+      static PeerServer* create() { return &instance(); }
+
+      // Starts listening for peers, returns false if the socket could not be created
+      bool    start();
+      QString address() const;
+
+      bool registerObject(const QString& path, QObject* object, QDBusConnection::RegisterOptions options = QDBusConnection::ExportAllContents);
+      bool registerVirtualObject(const QString& path, QDBusVirtualObject* object);
+      void unregisterObject(const QString& path, QDBusConnection::UnregisterMode mode = QDBusConnection::UnregisterNode);
+
+      // Sends a message, typically a signal, on the session bus and to every peer
+      void send(const QDBusMessage& message);
+
+    Q_SIGNALS:
+      void peerDisconnected(const QString& connectionName);
+
+    private Q_SLOTS:
+      void onNewConnection(const QDBusConnection& connection);
+      void prunePeers();
+
+    private:
+      struct Registration {
+          QPointer<QObject>                object;
+          bool                             isVirtual;
+          QDBusConnection::RegisterOptions options;
+      };
+
+      bool registerOn(QDBusConnection connection, const QString& path, const Registration& registration);
+
+      QDBusServer*                m_server;
+      QStringList                 m_peers;
+      QMap<QString, Registration> m_registrations;
+      QTimer                      m_prune_timer;
+  };
+}
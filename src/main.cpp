@@ -5,6 +5,7 @@
 
 #include "config/outputs/state.hpp"
 #include "dbus/ConfigService.hpp"
+#include "dbus/PeerServer.hpp"
 #include "outputs/state.hpp"
 #include "outputs/types.hpp"
 
@@ -14,6 +15,19 @@ int main(int argc, char* argv[]) {
   qDBusRegisterMetaType<bd::Outputs::NestedKvMap>();
   qDBusRegisterMetaType<bd::Outputs::OutputModeInfo>();
   qDBusRegisterMetaType<bd::Outputs::OutputModesMap>();
+  qDBusRegisterMetaType<bd::Outputs::ManagedObjectsMap>();
+  qDBusRegisterMetaType<bd::Outputs::OutputSnapshotInfo>();
+  qDBusRegisterMetaType<bd::Outputs::OutputsSnapshot>();
+  qDBusRegisterMetaType<QList<QVariantMap>>();
+  qDBusRegisterMetaType<bd::Outputs::OutputTargetStateInfo>();
+  qDBusRegisterMetaType<bd::Outputs::CalculationResultInfo>();
+  qDBusRegisterMetaType<bd::Outputs::ActionInfo>();
+  qDBusRegisterMetaType<QList<bd::Outputs::ActionInfo>>();
+  qDBusRegisterMetaType<bd::Outputs::ApplyOutcome>();
+  qDBusRegisterMetaType<bd::Outputs::ConfigDiagnostic>();
+  qDBusRegisterMetaType<QList<bd::Outputs::ConfigDiagnostic>>();
+  qDBusRegisterMetaType<bd::Outputs::HistoryEntryInfo>();
+  qDBusRegisterMetaType<QList<bd::Outputs::HistoryEntryInfo>>();
 
   qSetMessagePattern("[%{type}] %{if-debug}[%{file}:%{line} %{function}]%{endif}%{message}");
   if (!QDBusConnection::sessionBus().isConnected()) {
@@ -32,6 +46,9 @@ int main(int argc, char* argv[]) {
 
   app.connect(&orchestrator, &bd::Outputs::State::ready, &state, &bd::Config::Outputs::State::apply);
 
+  // Trusted session components can skip the bus daemon; everything registered from here on is served there as well
+  bd::PeerServer::instance().start();
+
   bd::ConfigService configService;
 
   orchestrator.init();
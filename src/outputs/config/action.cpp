@@ -1,4 +1,6 @@
 #include "action.hpp"
+#include <QDBusArgument>
+#include <QMetaEnum>
 #include <qdebug.h>
 
 namespace bd::Outputs::Config {
@@ -46,8 +48,9 @@ namespace bd::Outputs::Config {
         qDebug() << "Action::positionAnchor" << serial << relative << bd::Outputs::Config::HorizontalAnchor::toString(horizontal) << bd::Outputs::Config::VerticalAnchor::toString(vertical);
         auto action = QSharedPointer<Action>(new Action(ActionType::SetPositionAnchor, serial, parent));
         action->m_relative = QString { relative };
-        action->m_horizontal_anchor = horizontal;
-        action->m_vertical_anchor = vertical;
+        // Without a relative output the action clears the anchoring, there is nothing to anchor to
+        action->m_horizontal_anchor = relative.isEmpty() ? bd::Outputs::Config::HorizontalAnchor::None : horizontal;
+        action->m_vertical_anchor = relative.isEmpty() ? bd::Outputs::Config::VerticalAnchor::None : vertical;
         return action;
     }
 
@@ -79,6 +82,125 @@ namespace bd::Outputs::Config {
         return action;
     }
 
+    QSharedPointer<Action> Action::fromVariantMap(const QVariantMap& map, QString *error) {
+        auto fail = [error](const QString& message) {
+            if (error) *error = message;
+            return QSharedPointer<Action>(nullptr);
+        };
+
+        auto serial = map.value("serial").toString();
+        if (serial.isEmpty()) return fail("Action is missing a serial");
+
+        auto typeName = map.value("type").toString();
+        bool validType = false;
+        auto type = static_cast<ActionType::Type>(QMetaEnum::fromType<ActionType::Type>().keyToValue(typeName.toLatin1().constData(), &validType));
+        if (!validType) return fail(QString("Unknown action type '%1' for %2").arg(typeName, serial));
+
+        switch (type) {
+            case ActionType::Type::SetOnOff: {
+                // Anything but an explicit boolean would turn the output off by default
+                auto on = map.value("on");
+                if (on.typeId() != QMetaType::Bool) return fail(QString("SetOnOff for %1 needs a boolean on").arg(serial));
+                return on.toBool() ? explicitOn(serial) : explicitOff(serial);
+            }
+            case ActionType::Type::SetMode: {
+                // Accept the flat form clients can build easily, as well as the QSize form GetActions hands out
+                auto dimensions = map.contains("dimensions") ? qdbus_cast<QSize>(map.value("dimensions")) : QSize(map.value("width").toInt(), map.value("height").toInt());
+                auto refresh = map.value("refresh").toULongLong();
+                if (dimensions.isEmpty() || refresh == 0) return fail(QString("SetMode for %1 needs width, height and refresh").arg(serial));
+                return mode(serial, dimensions, refresh);
+            }
+            case ActionType::Type::SetPositionAnchor: {
+                // An empty or missing relative clears the anchoring, same as SetOutputPositionAnchor with an empty relativeSerial
+                auto relative = map.value("relative").toString();
+                return positionAnchor(serial, relative, HorizontalAnchor::fromString(map.value("horizontalAnchor").toString()),
+                                      VerticalAnchor::fromString(map.value("verticalAnchor").toString()));
+            }
+            case ActionType::Type::SetAbsolutePosition: {
+                auto position = map.contains("position") ? qdbus_cast<QPoint>(map.value("position")) : QPoint(map.value("x").toInt(), map.value("y").toInt());
+                return absolutePosition(serial, position);
+            }
+            case ActionType::Type::SetScale: {
+                auto value = map.value("scale").toDouble();
+                if (value <= 0) return fail(QString("SetScale for %1 needs a positive scale").arg(serial));
+                return scale(serial, value);
+            }
+            case ActionType::Type::SetTransform:
+                return transform(serial, static_cast<quint16>(map.value("transform").toUInt()));
+            case ActionType::Type::SetAdaptiveSync:
+                return adaptiveSync(serial, map.value("adaptiveSync").toUInt());
+            case ActionType::Type::SetPrimary:
+                return primary(serial);
+            case ActionType::Type::SetMirrorOf: {
+                auto relative = map.value("relative").toString();
+                if (relative.isEmpty()) return fail(QString("SetMirrorOf for %1 needs a relative output").arg(serial));
+                return mirrorOf(serial, relative);
+            }
+            default:
+                return fail(QString("Action type '%1' is not supported").arg(typeName));
+        }
+    }
+
+    QVariantMap Action::toVariantMap() const {
+        QVariantMap map;
+        map["type"] = ActionType::toString(m_action_type);
+        map["serial"] = m_serial;
+        switch (m_action_type) {
+            case ActionType::Type::SetOnOff:
+                map["on"] = m_on;
+                break;
+            case ActionType::Type::SetMode:
+                map["dimensions"] = QVariant::fromValue(m_dimensions);
+                map["refresh"] = m_refresh;
+                break;
+            case ActionType::Type::SetPositionAnchor:
+                map["relative"] = m_relative;
+                map["horizontalAnchor"] = HorizontalAnchor::toString(m_horizontal_anchor);
+                map["verticalAnchor"] = VerticalAnchor::toString(m_vertical_anchor);
+                break;
+            case ActionType::Type::SetAbsolutePosition:
+                map["position"] = QVariant::fromValue(m_absolute_position);
+                break;
+            case ActionType::Type::SetScale:
+                map["scale"] = m_scale;
+                break;
+            case ActionType::Type::SetTransform:
+                map["transform"] = m_transform;
+                break;
+            case ActionType::Type::SetAdaptiveSync:
+                map["adaptiveSync"] = m_adaptive_sync;
+                break;
+            case ActionType::Type::SetPrimary:
+                // No extra fields
+                break;
+            case ActionType::Type::SetMirrorOf:
+                map["relative"] = m_relative;
+                break;
+            default:
+                break;
+        }
+        return map;
+    }
+
+    bd::Outputs::ActionInfo Action::toDBusStruct() const {
+        bd::Outputs::ActionInfo info;
+        info.type = ActionType::toString(m_action_type);
+        info.serial = m_serial;
+        info.on = m_on;
+        info.width = m_dimensions.isValid() ? m_dimensions.width() : 0;
+        info.height = m_dimensions.isValid() ? m_dimensions.height() : 0;
+        info.refreshRate = m_refresh;
+        info.x = m_absolute_position.x();
+        info.y = m_absolute_position.y();
+        info.relative = m_relative;
+        info.horizontalAnchor = HorizontalAnchor::toString(m_horizontal_anchor);
+        info.verticalAnchor = VerticalAnchor::toString(m_vertical_anchor);
+        info.scale = m_scale;
+        info.transform = m_transform;
+        info.adaptiveSync = m_adaptive_sync;
+        return info;
+    }
+
     ActionType::Type Action::getActionType() const {
         return m_action_type;
     }
@@ -4,9 +4,11 @@
 #include <QPoint>
 #include <QSize>
 #include <QSharedPointer>
+#include <QVariantMap>
 
 #include "enums/actiontype.hpp"
 #include "enums/anchors.hpp"
+#include "outputs/types.hpp"
 
 namespace bd::Outputs::Config {
 
@@ -35,6 +37,9 @@ namespace bd::Outputs::Config {
         static QSharedPointer<Action> positionAnchor(const QString& serial, QString relative, HorizontalAnchor::Type horizontal,
             VerticalAnchor::Type vertical, QObject *parent = nullptr);
 
+        // Builds an action from its a{sv} D-Bus representation, returning nullptr and setting error if the map does not describe a valid action
+        static QSharedPointer<Action> fromVariantMap(const QVariantMap& map, QString *error = nullptr);
+
         ~Action() = default;
 
         ActionType::Type getActionType() const;
@@ -51,6 +56,9 @@ namespace bd::Outputs::Config {
         quint16 getTransform() const;
         uint32_t getAdaptiveSync() const;
 
+        QVariantMap toVariantMap() const;
+        bd::Outputs::ActionInfo toDBusStruct() const;
+
     protected:
         explicit Action(ActionType::Type action_type, QString serial,
                                      QObject *parent = nullptr);
@@ -2,6 +2,8 @@
 #include <QRect>
 #include <QStringList>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <utility>
 
 #include "config/outputs/state.hpp"
 #include "outputs/state.hpp"
@@ -9,9 +11,31 @@
 #include "model.hpp"
 
 namespace bd::Outputs::Config {
+    // Whether applying the target state would leave the head as it is
+    static bool isUnchanged(QSharedPointer<bd::Outputs::Wlr::MetaHead> head, QSharedPointer<TargetState> state) {
+        if (head->enabled() != state->isOn()) return false;
+        if (!state->isOn()) return true;
+
+        auto currentMode = head->getCurrentMode();
+        if (currentMode.isNull()) return false;
+        if (currentMode->getSize().value_or(QSize()) != state->getDimensions()) return false;
+        if (currentMode->getRefresh().value_or(0) != state->getRefresh()) return false;
+
+        return head->getPosition() == state->getPosition() && qFuzzyCompare(head->scale(), state->getScale()) && head->transform() == state->getTransform()
+            && head->adaptiveSync() == state->getAdaptiveSync();
+    }
+
     Model::Model(QObject *parent) : QObject(parent),
         m_calculation_result(QSharedPointer<Result>()),
-        m_actions(QList<QSharedPointer<Action>>()) {
+        m_actions(QList<QSharedPointer<Action>>()),
+        m_pending_batches(QQueue<Batch>()),
+        m_applying(false) {
+        // Move on to the next queued batch once the compositor has answered the current one
+        connect(this, &Model::configurationApplied, this, [this]() {
+            if (!m_applying) return;
+            m_applying = false;
+            QMetaObject::invokeMethod(this, &Model::applyNextBatch, Qt::QueuedConnection);
+        });
     }
 
     Model& Model::instance() {
@@ -64,15 +88,47 @@ namespace bd::Outputs::Config {
         }
     }
 
+    void Model::submit(const QList<QSharedPointer<Action>>& actions, QSharedPointer<Result> calculated,
+                       std::function<void(const bd::Outputs::ApplyOutcome&)> done) {
+        m_pending_batches.enqueue(Batch {actions, calculated, done});
+        if (!m_applying) applyNextBatch();
+    }
+
+    void Model::applyNextBatch() {
+        if (m_applying || m_pending_batches.isEmpty()) return;
+
+        m_applying = true;
+        reset();
+        auto batch = m_pending_batches.dequeue();
+        m_batch_done = batch.done;
+        for (const auto& action : batch.actions) {
+            addAction(action);
+        }
+
+        if (batch.calculated.isNull()) {
+            apply();
+            return;
+        }
+
+        m_calculation_result = batch.calculated;
+        applyCalculation();
+    }
+
     void Model::apply() {
         // Always recalculate before applying so the latest actions are reflected
         calculate();
+        applyCalculation();
+    }
 
+    void Model::applyCalculation() {
         auto &orchestrator = bd::Outputs::State::instance();
         auto manager = orchestrator.getManager();
+
+        bd::Outputs::ApplyOutcome outcome {false, false, 0, QStringList(), QStringList(), QStringList()};
         
         if (manager.isNull()) {
             qWarning() << "WaylandOutputManager is not available";
+            finishApply(outcome);
             return;
         }
 
@@ -80,6 +136,7 @@ namespace bd::Outputs::Config {
         auto config = manager->configure();
         if (config.isNull()) {
             qWarning() << "Failed to create WaylandOutputConfiguration";
+            finishApply(outcome);
             return;
         }
 
@@ -96,6 +153,7 @@ namespace bd::Outputs::Config {
             if (!outputStates.contains(serial)) {
                 qWarning() << "Model error: Head" << serial 
                           << "does not have a corresponding TargetState. This indicates a bug in the calculation logic.";
+                finishApply(outcome);
                 return;
             } else {
                 qDebug() << "Model: Head" << serial << "has a corresponding TargetState";
@@ -116,6 +174,9 @@ namespace bd::Outputs::Config {
 
             qDebug() << "Processing output" << serial << "on:" << outputState->isOn();
 
+            // Every head has to be part of the configuration, but report the ones we are not actually changing
+            (isUnchanged(head, outputState) ? outcome.unchangedHeads : outcome.changedHeads).append(serial);
+
             if (outputState->isOn()) {
                 // Enable the output and configure it
                 auto configHead = config->enable(head.data());
@@ -165,6 +226,7 @@ namespace bd::Outputs::Config {
                         configHead->setMode(mode.data());
                     } else {
                         qDebug() << "No existing mode found for output" << serial << "Setting custom mode";
+                        if (mode.isNull()) outcome.customModeFallbacks.append(serial);
                         // Use custom mode if no existing mode matches
                         configHead->setCustomMode(dimensions.width(), dimensions.height(), refresh);
                     }
@@ -181,8 +243,12 @@ namespace bd::Outputs::Config {
             }
         }
 
+        // Time how long the compositor takes to answer
+        QElapsedTimer timer;
+        timer.start();
+
         // Connect to configuration result signals
-        connect(config.data(), &bd::Outputs::Wlr::Configuration::succeeded, this, [this, config]() {
+        connect(config.data(), &bd::Outputs::Wlr::Configuration::succeeded, this, [this, config, outcome, timer]() mutable {
             qDebug() << "Configuration applied successfully";
             
             // Update and save the configuration
@@ -190,19 +256,24 @@ namespace bd::Outputs::Config {
             
             outputConfigState.save();
             
-            emit configurationApplied(true);
+            outcome.success = true;
+            outcome.durationMs = static_cast<qulonglong>(timer.elapsed());
+            finishApply(outcome);
             config->release();
         });
         
-        connect(config.data(), &bd::Outputs::Wlr::Configuration::failed, this, [this, config]() {
+        connect(config.data(), &bd::Outputs::Wlr::Configuration::failed, this, [this, config, outcome, timer]() mutable {
             qWarning() << "Configuration application failed";
-            emit configurationApplied(false);
+            outcome.durationMs = static_cast<qulonglong>(timer.elapsed());
+            finishApply(outcome);
             config->release();
         });
         
-        connect(config.data(), &bd::Outputs::Wlr::Configuration::cancelled, this, [this, config]() {
+        connect(config.data(), &bd::Outputs::Wlr::Configuration::cancelled, this, [this, config, outcome, timer]() mutable {
             qWarning() << "Configuration application was cancelled";
-            emit configurationApplied(false);
+            outcome.cancelled = true;
+            outcome.durationMs = static_cast<qulonglong>(timer.elapsed());
+            finishApply(outcome);
             config->release();
         });
 
@@ -211,8 +282,17 @@ namespace bd::Outputs::Config {
         config->applySelf();
     }
 
+    void Model::finishApply(const bd::Outputs::ApplyOutcome &outcome) {
+        qDebug() << "Apply outcome - success:" << outcome.success << "cancelled:" << outcome.cancelled << "duration (ms):" << outcome.durationMs
+                 << "changed:" << outcome.changedHeads << "unchanged:" << outcome.unchangedHeads << "custom mode fallbacks:" << outcome.customModeFallbacks;
+        // Taken first, the callback may well submit another batch
+        if (auto done = std::exchange(m_batch_done, nullptr)) done(outcome);
+        emit configurationOutcome(outcome);
+        emit configurationApplied(outcome.success);
+    }
+
     void Model::calculate() {
-        m_calculation_result = QSharedPointer<Result>(new Result(this));
+        m_calculation_result = QSharedPointer<Result>(new Result());
 
         // Create our output target states for each serial first
         auto &orchestrator = bd::Outputs::State::instance();
@@ -288,6 +368,15 @@ namespace bd::Outputs::Config {
             }
         }
 
+        // There is only one primary, the one set by the batch takes it from whichever head has it now
+        for (auto action : m_actions) {
+            if (action->getActionType() != ActionType::SetPrimary) continue;
+            for (auto serial : pendingOutputStates.keys()) {
+                auto outputState = pendingOutputStates[serial];
+                if (!outputState.isNull() && serial != action->getSerial()) outputState->setPrimary(false);
+            }
+        }
+
         // Update resulting dimensions for all outputs
         for (auto outputState : pendingOutputStates.values()) {
             if (!outputState.isNull()) {
@@ -310,7 +399,8 @@ namespace bd::Outputs::Config {
             auto unanchoredOutputs = QList<QString>();
 
             for (auto action : m_actions) {
-                if (action->getActionType() == ActionType::SetPositionAnchor) {
+                // An anchor without a relative output only clears the anchoring
+                if (action->getActionType() == ActionType::SetPositionAnchor && !action->getRelative().isEmpty()) {
                     anchorMap.insert(action->getSerial(), action->getRelative());
                 }
             }
@@ -4,8 +4,11 @@
 #include <QSharedPointer>
 #include <QMap>
 #include <QList>
+#include <QQueue>
+#include <functional>
 #include "action.hpp"
 #include "result.hpp"
+#include "outputs/types.hpp"
 
 namespace bd::Outputs::Config {
     class Model : public QObject {
@@ -22,6 +25,13 @@ namespace bd::Outputs::Config {
         // Performs a calculation if necessary and applies them
         void apply();
 
+        // Queues a complete batch of actions to be applied once any in-flight configuration has finished.
+        // Batches are applied one at a time, replacing the actions currently held by this model.
+        // A calculated result can be handed in alongside, it is then applied as is rather than calculated again.
+        // done is called with the outcome of this batch only, right before configurationOutcome is emitted for it.
+        void submit(const QList<QSharedPointer<Action>>& actions, QSharedPointer<Result> calculated = nullptr,
+                    std::function<void(const bd::Outputs::ApplyOutcome&)> done = nullptr);
+
         // Calculate potential resulting state from all actions
         // This does not apply the actions.
         void calculate();
@@ -34,10 +44,27 @@ namespace bd::Outputs::Config {
 
     signals:
         void configurationApplied(bool success);
+        // Emitted right before configurationApplied, with the per-head details
+        void configurationOutcome(const bd::Outputs::ApplyOutcome &outcome);
 
     private:
+        struct Batch {
+            QList<QSharedPointer<Action>> actions;
+            QSharedPointer<Result> calculated;
+            std::function<void(const bd::Outputs::ApplyOutcome&)> done;
+        };
+
         QSharedPointer<Result> m_calculation_result;
         QList<QSharedPointer<Action>> m_actions;
+        QQueue<Batch> m_pending_batches;
+        // Callback of the batch being applied
+        std::function<void(const bd::Outputs::ApplyOutcome&)> m_batch_done;
+        bool m_applying;
+
+        void applyNextBatch();
+        // Applies m_calculation_result as it stands
+        void applyCalculation();
+        void finishApply(const bd::Outputs::ApplyOutcome &outcome);
 
         // Helper method for calculating anchored positions
         QPoint calculateAnchoredPosition(QSharedPointer<TargetState> outputState, QSharedPointer<TargetState> relativeState);
@@ -53,4 +53,32 @@ namespace bd::Outputs::Config {
         map["outputs"] = outputs;
         return map;
     }
-}
\ No newline at end of file
+
+    bd::Outputs::CalculationResultInfo Result::toDBusStruct() const {
+        bd::Outputs::CalculationResultInfo info;
+        if (m_global_space) info.globalSpace = *m_global_space;
+        for (auto it = m_output_states.begin(); it != m_output_states.end(); ++it) {
+            auto state = it.value();
+            if (!state) continue;
+
+            bd::Outputs::OutputTargetStateInfo out;
+            out.serial = it.key();
+            out.on = state->isOn();
+            out.x = state->getPosition().x();
+            out.y = state->getPosition().y();
+            out.width = state->getDimensions().width();
+            out.height = state->getDimensions().height();
+            out.refreshRate = state->getRefresh();
+            out.scale = state->getScale();
+            out.transform = state->getTransform();
+            out.adaptiveSync = state->getAdaptiveSync();
+            out.primary = state->isPrimary();
+            out.resultingWidth = state->getResultingDimensions().width();
+            out.resultingHeight = state->getResultingDimensions().height();
+            out.horizontalAnchor = bd::Outputs::Config::HorizontalAnchor::toString(state->getHorizontalAnchor());
+            out.verticalAnchor = bd::Outputs::Config::VerticalAnchor::toString(state->getVerticalAnchor());
+            info.outputs.append(out);
+        }
+        return info;
+    }
+}
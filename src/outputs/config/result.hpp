@@ -5,6 +5,7 @@
 #include <QMap>
 #include <QRect>
 #include "targetstate.hpp"
+#include "outputs/types.hpp"
 
 namespace bd::Outputs::Config {
     class Result : public QObject {
@@ -17,6 +18,7 @@ namespace bd::Outputs::Config {
         QSharedPointer<QRect> getGlobalSpace() const;
         QMap<QString, QSharedPointer<TargetState>> getOutputStates() const;
         QVariantMap toVariantMap() const;
+        bd::Outputs::CalculationResultInfo toDBusStruct() const;
 
         void setOutputState(QString serial, QSharedPointer<TargetState> output_state);
 
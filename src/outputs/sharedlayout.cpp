@@ -0,0 +1,134 @@
+#include "sharedlayout.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <QDebug>
+#include <QString>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+namespace bd::Outputs {
+  SharedLayout::SharedLayout() : m_fd(-1), m_read_fd(-1), m_region(nullptr), m_failed(false) {}
+
+  SharedLayout::~SharedLayout() {
+    if (m_region) munmap(m_region, sizeof(SharedLayoutRegion));
+    if (m_read_fd >= 0) close(m_read_fd);
+    if (m_fd >= 0) close(m_fd);
+  }
+
+  int SharedLayout::fd() const {
+    return m_read_fd;
+  }
+
+  bool SharedLayout::create() {
+    if (m_region) return true;
+    if (m_failed) return false;
+
+    auto fd = memfd_create("budgie-desktop-services-layout", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+      qWarning() << "Failed to create shared layout memfd:" << std::strerror(errno);
+      m_failed = true;
+      return false;
+    }
+
+    if (ftruncate(fd, sizeof(SharedLayoutRegion)) < 0) {
+      qWarning() << "Failed to size shared layout memfd:" << std::strerror(errno);
+      close(fd);
+      m_failed = true;
+      return false;
+    }
+
+    auto region = mmap(nullptr, sizeof(SharedLayoutRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (region == MAP_FAILED) {
+      qWarning() << "Failed to map shared layout memfd:" << std::strerror(errno);
+      close(fd);
+      m_failed = true;
+      return false;
+    }
+
+    // Our own mapping stays writable, but nobody else gets to write to or resize the region. Unsealed it is not handed out at all.
+    int seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+#ifdef F_SEAL_FUTURE_WRITE
+    seals |= F_SEAL_FUTURE_WRITE;
+#endif
+    if (fcntl(fd, F_ADD_SEALS, seals) < 0) {
+      qWarning() << "Failed to seal shared layout memfd:" << std::strerror(errno);
+      munmap(region, sizeof(SharedLayoutRegion));
+      close(fd);
+      m_failed = true;
+      return false;
+    }
+
+    // Readers get a descriptor of their own opened read-only, which can't be mapped writable whatever the seals allow
+    auto read_fd = open(QString("/proc/self/fd/%1").arg(fd).toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (read_fd < 0) {
+      qWarning() << "Failed to reopen shared layout memfd read-only:" << std::strerror(errno);
+      munmap(region, sizeof(SharedLayoutRegion));
+      close(fd);
+      m_failed = true;
+      return false;
+    }
+
+    m_fd      = fd;
+    m_read_fd = read_fd;
+    m_region  = static_cast<SharedLayoutRegion*>(region);
+
+    // ftruncate zero filled the region, so the sequence starts out even
+    new (&m_region->header.sequence) std::atomic<uint32_t>(0);
+    m_region->header.magic        = SHARED_LAYOUT_MAGIC;
+    m_region->header.version      = SHARED_LAYOUT_VERSION;
+    m_region->header.primaryIndex = -1;
+    return true;
+  }
+
+  void SharedLayout::publish(const OutputsSnapshot& snapshot) {
+    if (!create()) return;
+
+    auto& header = m_region->header;
+
+    // Enter the write section, readers retry until the sequence is even again
+    header.sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto count = qMin(snapshot.outputs.size(), qsizetype(SHARED_LAYOUT_MAX_OUTPUTS));
+    if (snapshot.outputs.size() > SHARED_LAYOUT_MAX_OUTPUTS) {
+      qWarning() << "Shared layout only holds" << SHARED_LAYOUT_MAX_OUTPUTS << "outputs, dropping" << snapshot.outputs.size() - count;
+    }
+
+    header.outputCount  = static_cast<uint32_t>(count);
+    header.generation   = snapshot.generation;
+    header.globalX      = snapshot.globalRect.x();
+    header.globalY      = snapshot.globalRect.y();
+    header.globalWidth  = snapshot.globalRect.width();
+    header.globalHeight = snapshot.globalRect.height();
+    header.primaryIndex = -1;
+
+    for (qsizetype i = 0; i < count; ++i) {
+      const auto& info   = snapshot.outputs.at(i);
+      auto&       output = m_region->outputs[i];
+
+      auto serial = info.serial.toUtf8();
+      std::memset(output.serial, 0, sizeof(output.serial));
+      std::memcpy(output.serial, serial.constData(), qMin(serial.size(), qsizetype(sizeof(output.serial) - 1)));
+
+      output.x         = info.x;
+      output.y         = info.y;
+      output.width     = info.width;
+      output.height    = info.height;
+      output.scale     = info.scale;
+      output.transform = info.transform;
+      output.flags     = (info.enabled ? SharedLayoutEnabled : 0) | (info.primary ? SharedLayoutPrimary : 0) | (info.builtIn ? SharedLayoutBuiltIn : 0);
+
+      if (info.serial == snapshot.primaryOutput) header.primaryIndex = static_cast<int32_t>(i);
+    }
+
+    // Clear stale slots so a removed output never reappears
+    for (auto i = count; i < SHARED_LAYOUT_MAX_OUTPUTS; ++i) { std::memset(&m_region->outputs[i], 0, sizeof(SharedLayoutOutput)); }
+
+    // Leave the write section
+    header.sequence.fetch_add(1, std::memory_order_release);
+  }
+}
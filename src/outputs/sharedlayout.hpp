@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "outputs/types.hpp"
+
+#define SHARED_LAYOUT_MAGIC 0x594c4442  // "BDLY"
+#define SHARED_LAYOUT_VERSION 1
+#define SHARED_LAYOUT_MAX_OUTPUTS 16
+#define SHARED_LAYOUT_SERIAL_SIZE 64
+
+namespace bd::Outputs {
+  // The committed layout, published into a sealed memfd that readers map read-only (fd from Outputs.GetLayoutFd).
+  //
+  // Readers use the sequence as a seqlock: read it (retry while odd), copy the header and outputs, then read it again and retry if it moved.
+  // All fields are host endian, the region never changes size for a given version.
+  struct SharedLayoutOutput {
+      char     serial[SHARED_LAYOUT_SERIAL_SIZE];  // NUL terminated, truncated if longer
+      int32_t  x;
+      int32_t  y;
+      int32_t  width;
+      int32_t  height;
+      double   scale;
+      uint32_t transform;  // wl_output transform
+      uint32_t flags;      // SharedLayoutOutputFlags
+  };
+
+  enum SharedLayoutOutputFlags : uint32_t {
+    SharedLayoutEnabled = 1 << 0,
+    SharedLayoutPrimary = 1 << 1,
+    SharedLayoutBuiltIn = 1 << 2,
+  };
+
+  struct SharedLayoutHeader {
+      uint32_t              magic;
+      uint32_t              version;
+      std::atomic<uint32_t> sequence;  // Odd while a write is in progress
+      uint32_t              outputCount;
+      uint64_t              generation;
+      int32_t               globalX;
+      int32_t               globalY;
+      int32_t               globalWidth;
+      int32_t               globalHeight;
+      int32_t               primaryIndex;  // Index into outputs, -1 if there is no primary output
+      uint32_t              reserved;
+  };
+
+  struct SharedLayoutRegion {
+      SharedLayoutHeader header;
+      SharedLayoutOutput outputs[SHARED_LAYOUT_MAX_OUTPUTS];
+  };
+
+  static_assert(std::atomic<uint32_t>::is_always_lock_free, "The seqlock must be usable across processes");
+
+  class SharedLayout {
+    public:
+      SharedLayout();
+      ~SharedLayout();
+
+      SharedLayout(const SharedLayout&)            = delete;
+      SharedLayout& operator=(const SharedLayout&) = delete;
+
+      // Writes the snapshot into the region, creating it on first use
+      void publish(const OutputsSnapshot& snapshot);
+
+      // Read-only descriptor for the region, -1 if it could not be created and sealed
+      int fd() const;
+
+    private:
+      bool create();
+
+      int                 m_fd;
+      int                 m_read_fd;
+      SharedLayoutRegion* m_region;
+      bool                m_failed;
+  };
+}
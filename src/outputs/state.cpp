@@ -7,11 +7,14 @@
 #include <QCoreApplication>
 #include <QDBusConnection>
 #include <QMap>
+#include <QSet>
 #include <QThread>
 #include <QTimer>
 #include <cstring>
 
 #include "config/outputs/state.hpp"
+#include "dbus/ObjectManager.hpp"
+#include "dbus/PeerServer.hpp"
 #include "outputs/config/model.hpp"
 #include "outputs/wlr/metahead.hpp"
 #include "outputs/wlr/metamode.hpp"
@@ -27,6 +30,11 @@ namespace bd::Outputs {
         m_has_serial(false),
         m_serial(0),
         m_has_initted(false),
+        m_generation(0),
+        m_checked_generation(0),
+        m_cached_available_outputs(QStringList()),
+        m_cached_exported_outputs(QStringList()),
+        m_cached_output_generations(QMap<QString, qulonglong>()),
         m_cached_primary_output(QString()),
         m_cached_global_rect(QVariantMap()),
         m_cached_primary_output_rect(QVariantMap()) {}
@@ -89,6 +97,10 @@ namespace bd::Outputs {
     return outputs;
   }
 
+  qulonglong State::generation() const {
+    return m_generation;
+  }
+
   static QSharedPointer<bd::Outputs::Wlr::MetaHead> getPrimaryOrFirstHead() {
     auto manager = bd::Outputs::State::instance().getManager();
     if (!manager) return nullptr;
@@ -148,11 +160,84 @@ namespace bd::Outputs {
     return rect;
   }
 
+  bd::Outputs::OutputsSnapshot State::GetSnapshot() {
+    // Make sure the generation we hand out matches the data alongside it
+    refreshCachedState();
+    return buildSnapshot();
+  }
+
+  bd::Outputs::OutputsSnapshot State::buildSnapshot() const {
+    bd::Outputs::OutputsSnapshot snapshot;
+    snapshot.globalRect    = getGlobalQRect();
+    snapshot.primaryOutput = primaryOutput();
+    snapshot.generation    = m_generation;
+
+    if (!m_manager) return snapshot;
+    for (const auto& output : m_manager->getHeads()) {
+      if (output) snapshot.outputs.append(output->toDBusStruct());
+    }
+    return snapshot;
+  }
+
+  bool State::GetIfChanged(qulonglong generation, bd::Outputs::OutputsSnapshot& snapshot) {
+    refreshCachedState();
+    if (generation == m_generation) {
+      snapshot            = bd::Outputs::OutputsSnapshot {};
+      snapshot.generation = m_generation;
+      return false;
+    }
+
+    snapshot = buildSnapshot();
+    return true;
+  }
+
+  QDBusUnixFileDescriptor State::GetLayoutFd() {
+    if (calledFromDBus() && !(connection().connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing)) {
+      sendErrorReply(QDBusError::NotSupported, "This connection cannot pass file descriptors");
+      return QDBusUnixFileDescriptor();
+    }
+
+    // Make sure the region exists and holds the current layout before handing it out
+    if (m_shared_layout.fd() < 0) m_shared_layout.publish(buildSnapshot());
+    if (m_shared_layout.fd() < 0) {
+      if (calledFromDBus()) sendErrorReply(QDBusError::Failed, "The shared layout is not available");
+      return QDBusUnixFileDescriptor();
+    }
+
+    // QDBusUnixFileDescriptor duplicates the descriptor, our own stays open
+    return QDBusUnixFileDescriptor(m_shared_layout.fd());
+  }
+
   void State::registerDbusService() {
     const QString OUTPUTS_SERVICE_PATH = "/org/buddiesofbudgie/Services/Outputs";
     qInfo() << "Registering DBus object at path" << OUTPUTS_SERVICE_PATH;
-    if (!QDBusConnection::sessionBus().registerObject(OUTPUTS_SERVICE_PATH, this, QDBusConnection::ExportAllContents)) {
+    if (!bd::PeerServer::instance().registerObject(OUTPUTS_SERVICE_PATH, this)) {
       qCritical() << "Failed to register DBus object at path" << OUTPUTS_SERVICE_PATH;
+      return;
+    }
+    bd::ObjectManager::instance().objectAdded(OUTPUTS_SERVICE_PATH, this);
+  }
+
+  void State::registerHeads() {
+    if (!m_manager) return;
+
+    auto heads = m_manager->getHeads();
+
+    // Identifiers already exported, either during init or a previous done event
+    QSet<QString> registered;
+    for (const auto& output : heads) {
+      if (output && output->isDbusRegistered()) registered.insert(output->getIdentifier());
+    }
+
+    for (const auto& output : heads) {
+      if (!output) continue;
+
+      QString outputId = output->getIdentifier();
+      if (registered.contains(outputId)) continue;
+
+      // This will also register all modes for this output
+      output->registerDbusService();
+      registered.insert(outputId);
     }
   }
 
@@ -169,33 +254,18 @@ namespace bd::Outputs {
 
       qInfo() << "Registering DBus services for outputs and modes";
 
+      // Register the object manager on the services root, so it sees every object registered below
+      bd::ObjectManager::instance().registerDbusService();
+
       // Register the Outputs service (this object)
       registerDbusService();
 
-      // Register all output objects (which will also register their modes) and connect signals
-      if (m_manager) {
-        QMap<QString, bd::Outputs::Wlr::MetaHead*> m_outputServices;
-
-        for (const auto& output : m_manager->getHeads()) {
-          if (!output) continue;
-
-          QString outputId = output->getIdentifier();
-
-          if (m_outputServices.contains(outputId)) continue;
+      // Register all output objects (which will also register their modes)
+      registerHeads();
 
-          // Connect to head signals
-          connectHeadSignals(output);
-
-          // This will also register all modes for this output
-          output->registerDbusService();
-          m_outputServices[outputId] = output.data();
-        }
-      }
-
-      // Initialize cached values
-      m_cached_primary_output      = getCurrentPrimaryOutput();
-      m_cached_global_rect         = getCurrentGlobalRect();
-      m_cached_primary_output_rect = getCurrentPrimaryOutputRect();
+      // Initialize cached values, the initial layout is not a change that needs saving
+      refreshCachedState();
+      m_checked_generation = m_generation;
 
       // Connect to Model's configurationApplied signal to update global rect
       connect(&bd::Outputs::Config::Model::instance(), &bd::Outputs::Config::Model::configurationApplied, this, &State::checkAndEmitSignals);
@@ -203,6 +273,21 @@ namespace bd::Outputs {
       emit ready();  // Haven't done our first init, emit that we are ready
     }
     m_has_initted = true;
+
+    // Export any output hotplugged since the last done event. We wait for done rather than headAdded, as the identifier is only known once the
+    // head has sent its properties.
+    registerHeads();
+
+    // The output manager done event closes a commit cycle, announce everything that changed on each output in one go
+    if (m_manager) {
+      for (const auto& output : m_manager->getHeads()) {
+        if (output) output->flushPropertiesChanged();
+      }
+    }
+
+    // Catch changes that did not come with a stateChanged, such as anchoring or primary updates
+    checkAndEmitSignals();
+
     emit done();
   }
 
@@ -215,18 +300,77 @@ namespace bd::Outputs {
   void State::onHeadRemoved(QSharedPointer<Wlr::MetaHead> head) {
     if (!head) return;
     disconnectHeadSignals(head);
+    head->unregisterDbusService();
     checkAndEmitSignals();
   }
 
   void State::checkAndEmitSignals() {
+    // Nothing in the layout changed since we last looked, no need to save anything. A getter may have refreshed the cache already, so compare
+    // generations rather than relying on the result of this refresh.
+    refreshCachedState();
+    if (m_generation == m_checked_generation) return;
+    m_checked_generation = m_generation;
+
+    // If we are in shim mode, record the state since a head has triggered a change. It goes to the runtime state file, not the config.
+    if (bd::SysInfo::instance().isShimMode()) {
+      qDebug() << "Recording state since a head has triggered a change in shim mode";
+      bd::Config::Outputs::State::instance().recordRuntimeState();
+    }
+  }
+
+  bool State::refreshCachedState() {
+    auto changed = false;
+
     // Check available outputs
-    emit availableOutputsChanged();
+    QStringList currentOutputs = availableOutputs();
+    if (currentOutputs != m_cached_available_outputs) {
+      m_cached_available_outputs = currentOutputs;
+      emit availableOutputsChanged();
+      changed = true;
+    }
+
+    // Check the outputs themselves, each bumps its own generation on any property change
+    QMap<QString, qulonglong> currentGenerations;
+    QStringList               currentExported;
+    if (m_manager) {
+      for (const auto& output : m_manager->getHeads()) {
+        if (!output) continue;
+        currentGenerations.insert(output->getIdentifier(), output->generation());
+        if (output->isDbusRegistered()) currentExported.append(output->getIdentifier());
+      }
+    }
+
+    // Only outputs that are actually on the bus are announced, so a client can use the paths right away
+    if (currentExported != m_cached_exported_outputs) {
+      QStringList            added, removed;
+      QList<QDBusObjectPath> addedPaths, removedPaths;
+      for (const auto& serial : std::as_const(currentExported)) {
+        if (m_cached_exported_outputs.contains(serial)) continue;
+        added.append(serial);
+        addedPaths.append(QDBusObjectPath(QString("/org/buddiesofbudgie/Services/Outputs/%1").arg(serial)));
+      }
+      for (const auto& serial : std::as_const(m_cached_exported_outputs)) {
+        if (currentExported.contains(serial)) continue;
+        removed.append(serial);
+        removedPaths.append(QDBusObjectPath(QString("/org/buddiesofbudgie/Services/Outputs/%1").arg(serial)));
+      }
+      m_cached_exported_outputs = currentExported;
+
+      if (!removed.isEmpty()) emit OutputsRemoved(removed, removedPaths);
+      if (!added.isEmpty()) emit OutputsAdded(added, addedPaths);
+      changed = true;
+    }
+    if (currentGenerations != m_cached_output_generations) {
+      m_cached_output_generations = currentGenerations;
+      changed = true;
+    }
 
     // Check primary output
     QString currentPrimary = getCurrentPrimaryOutput();
     if (currentPrimary != m_cached_primary_output) {
       m_cached_primary_output = currentPrimary;
       emit primaryOutputChanged();
+      changed = true;
     }
 
     // Check primary output rect
@@ -234,6 +378,7 @@ namespace bd::Outputs {
     if (currentPrimaryRect != m_cached_primary_output_rect) {
       m_cached_primary_output_rect = currentPrimaryRect;
       emit primaryOutputRectChanged();
+      changed = true;
     }
 
     // Check global rect
@@ -241,24 +386,21 @@ namespace bd::Outputs {
     if (currentGlobalRect != m_cached_global_rect) {
       m_cached_global_rect = currentGlobalRect;
       emit globalRectChanged();
+      changed = true;
     }
 
-    // If we are in shim mode, save the state since a head has triggered a change
-    if (bd::SysInfo::instance().isShimMode()) {
-      // Update the output configs from the heads
-      auto activeGroup = bd::Config::Outputs::State::instance().activeGroup();
-      if (activeGroup) {
-        qDebug() << "Saving state since a head has triggered a change in shim mode";
-        for (const auto& output : activeGroup->outputConfigs()) { output->updateFromHead(); }
-        // Save the state
-        bd::Config::Outputs::State::instance().save();
-      }
+    if (changed) {
+      m_generation++;
+      // Shared memory readers see the new layout before anyone is told about it. The region is only created once a client asks for it.
+      if (m_shared_layout.fd() >= 0) m_shared_layout.publish(buildSnapshot());
+      emit generationChanged(m_generation);
     }
+    return changed;
   }
 
   void State::connectHeadSignals(QSharedPointer<Wlr::MetaHead> head) {
     if (!head) return;
-    connect(head.data(), &Wlr::MetaHead::stateChanged, this, &State::checkAndEmitSignals);
+    connect(head.data(), &Wlr::MetaHead::stateChanged, this, &State::checkAndEmitSignals, Qt::UniqueConnection);
   }
 
   void State::disconnectHeadSignals(QSharedPointer<Wlr::MetaHead> head) {
@@ -278,4 +420,13 @@ namespace bd::Outputs {
   QVariantMap State::getCurrentPrimaryOutputRect() const {
     return primaryOutputRect();
   }
+
+  QRect State::getGlobalQRect() const {
+    auto calculationResult = bd::Outputs::Config::Model::instance().getCalculationResult();
+    if (!calculationResult) return QRect();
+
+    auto globalSpace = calculationResult->getGlobalSpace();
+    if (!globalSpace) return QRect();
+    return *globalSpace;
+  }
 }
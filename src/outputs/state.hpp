@@ -6,8 +6,13 @@
 #include <wayland-util.h>
 
 #include <QDBusContext>
+#include <QDBusObjectPath>
+#include <QDBusUnixFileDescriptor>
+#include <QMap>
 #include <QObject>
 
+#include "outputs/sharedlayout.hpp"
+#include "outputs/types.hpp"
 #include "outputs/wlr/outputmanager.hpp"
 
 namespace bd::Outputs {
@@ -17,6 +22,7 @@ namespace bd::Outputs {
       Q_OBJECT
       Q_CLASSINFO("D-Bus Interface", "org.buddiesofbudgie.Services.Outputs")
       Q_PROPERTY(QStringList availableOutputs READ availableOutputs NOTIFY availableOutputsChanged)
+      Q_PROPERTY(qulonglong generation READ generation NOTIFY generationChanged)
       Q_PROPERTY(QVariantMap globalRect READ globalRect NOTIFY globalRectChanged)
       Q_PROPERTY(QString primaryOutput READ primaryOutput NOTIFY primaryOutputChanged)
       Q_PROPERTY(QVariantMap primaryOutputRect READ primaryOutputRect NOTIFY primaryOutputRectChanged)
@@ -37,6 +43,8 @@ namespace bd::Outputs {
 
       // Property getters
       QStringList availableOutputs() const;
+      // Layout generation, bumped only when something in the layout actually changed
+      qulonglong  generation() const;
       QVariantMap globalRect() const;
       QString     primaryOutput() const;
       QVariantMap primaryOutputRect() const;
@@ -49,6 +57,10 @@ namespace bd::Outputs {
       void done();
       void orchestratorInitFailed(QString error);
       void availableOutputsChanged();
+      // Carry only the outputs that appeared or went away on the bus, with their object paths
+      void OutputsAdded(const QStringList& serials, const QList<QDBusObjectPath>& paths);
+      void OutputsRemoved(const QStringList& serials, const QList<QDBusObjectPath>& paths);
+      void generationChanged(qulonglong generation);
       void globalRectChanged();
       void primaryOutputChanged();
       void primaryOutputRectChanged();
@@ -56,17 +68,30 @@ namespace bd::Outputs {
     public Q_SLOTS:
       void outputManagerDone();
 
+      // Every output, the global rect, the primary output and the current generation in a single message
+      bd::Outputs::OutputsSnapshot GetSnapshot();
+
+      // Returns false and an empty snapshot if the layout is still at the given generation, so clients can skip re-reading unchanged data
+      bool GetIfChanged(qulonglong generation, bd::Outputs::OutputsSnapshot& snapshot);
+
+      // Read-only memfd holding the committed layout behind a seqlock (see sharedlayout.hpp), so frequent readers need no IPC at all
+      QDBusUnixFileDescriptor GetLayoutFd();
+
     private Q_SLOTS:
       void onHeadAdded(QSharedPointer<Wlr::MetaHead> head);
       void onHeadRemoved(QSharedPointer<Wlr::MetaHead> head);
       void checkAndEmitSignals();
 
     private:
+      void        registerHeads();
+      bool        refreshCachedState();
+      bd::Outputs::OutputsSnapshot buildSnapshot() const;
       void        connectHeadSignals(QSharedPointer<Wlr::MetaHead> head);
       void        disconnectHeadSignals(QSharedPointer<Wlr::MetaHead> head);
       QString     getCurrentPrimaryOutput() const;
       QVariantMap getCurrentGlobalRect() const;
       QVariantMap getCurrentPrimaryOutputRect() const;
+      QRect       getGlobalQRect() const;
 
       KWayland::Client::ConnectionThread* m_connection;
       KWayland::Client::Registry*         m_registry;
@@ -75,9 +100,15 @@ namespace bd::Outputs {
       bool                                m_has_initted;
       bool                                m_has_serial;
       int                                 m_serial;
+      qulonglong                          m_generation;
+      qulonglong                          m_checked_generation;
+      QStringList                         m_cached_available_outputs;
+      QStringList                         m_cached_exported_outputs;
+      QMap<QString, qulonglong>           m_cached_output_generations;
       QString                             m_cached_primary_output;
       QVariantMap                         m_cached_global_rect;
       QVariantMap                         m_cached_primary_output_rect;
+      SharedLayout                        m_shared_layout;
   };
 
 }
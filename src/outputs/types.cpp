@@ -41,3 +41,135 @@ const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::Outp
   argument.endMap();
   return argument;
 }
+
+QDBusArgument& operator<<(QDBusArgument& argument, const bd::Outputs::OutputSnapshotInfo& outputInfo) {
+  argument.beginStructure();
+  argument << outputInfo.serial << outputInfo.name << outputInfo.make << outputInfo.model << outputInfo.description;
+  argument << outputInfo.enabled << outputInfo.builtIn << outputInfo.primary;
+  argument << outputInfo.x << outputInfo.y << outputInfo.width << outputInfo.height << outputInfo.refreshRate;
+  argument << outputInfo.scale << outputInfo.transform << outputInfo.adaptiveSync;
+  argument << outputInfo.mirrorOf << outputInfo.relativeTo << outputInfo.horizontalAnchor << outputInfo.verticalAnchor;
+  argument << outputInfo.currentMode << outputInfo.modes;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::OutputSnapshotInfo& outputInfo) {
+  argument.beginStructure();
+  argument >> outputInfo.serial >> outputInfo.name >> outputInfo.make >> outputInfo.model >> outputInfo.description;
+  argument >> outputInfo.enabled >> outputInfo.builtIn >> outputInfo.primary;
+  argument >> outputInfo.x >> outputInfo.y >> outputInfo.width >> outputInfo.height >> outputInfo.refreshRate;
+  argument >> outputInfo.scale >> outputInfo.transform >> outputInfo.adaptiveSync;
+  argument >> outputInfo.mirrorOf >> outputInfo.relativeTo >> outputInfo.horizontalAnchor >> outputInfo.verticalAnchor;
+  argument >> outputInfo.currentMode >> outputInfo.modes;
+  argument.endStructure();
+  return argument;
+}
+
+QDBusArgument& operator<<(QDBusArgument& argument, const bd::Outputs::OutputsSnapshot& snapshot) {
+  argument.beginStructure();
+  argument << snapshot.outputs << snapshot.globalRect << snapshot.primaryOutput << snapshot.generation;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::OutputsSnapshot& snapshot) {
+  argument.beginStructure();
+  argument >> snapshot.outputs >> snapshot.globalRect >> snapshot.primaryOutput >> snapshot.generation;
+  argument.endStructure();
+  return argument;
+}
+
+QDBusArgument& operator<<(QDBusArgument& argument, const bd::Outputs::OutputTargetStateInfo& stateInfo) {
+  argument.beginStructure();
+  argument << stateInfo.serial << stateInfo.on << stateInfo.x << stateInfo.y << stateInfo.width << stateInfo.height << stateInfo.refreshRate;
+  argument << stateInfo.scale << stateInfo.transform << stateInfo.adaptiveSync << stateInfo.primary;
+  argument << stateInfo.resultingWidth << stateInfo.resultingHeight << stateInfo.horizontalAnchor << stateInfo.verticalAnchor;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::OutputTargetStateInfo& stateInfo) {
+  argument.beginStructure();
+  argument >> stateInfo.serial >> stateInfo.on >> stateInfo.x >> stateInfo.y >> stateInfo.width >> stateInfo.height >> stateInfo.refreshRate;
+  argument >> stateInfo.scale >> stateInfo.transform >> stateInfo.adaptiveSync >> stateInfo.primary;
+  argument >> stateInfo.resultingWidth >> stateInfo.resultingHeight >> stateInfo.horizontalAnchor >> stateInfo.verticalAnchor;
+  argument.endStructure();
+  return argument;
+}
+
+QDBusArgument& operator<<(QDBusArgument& argument, const bd::Outputs::CalculationResultInfo& resultInfo) {
+  argument.beginStructure();
+  argument << resultInfo.globalSpace << resultInfo.outputs;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::CalculationResultInfo& resultInfo) {
+  argument.beginStructure();
+  argument >> resultInfo.globalSpace >> resultInfo.outputs;
+  argument.endStructure();
+  return argument;
+}
+
+QDBusArgument& operator<<(QDBusArgument& argument, const bd::Outputs::ActionInfo& actionInfo) {
+  argument.beginStructure();
+  argument << actionInfo.type << actionInfo.serial << actionInfo.on << actionInfo.width << actionInfo.height << actionInfo.refreshRate;
+  argument << actionInfo.x << actionInfo.y << actionInfo.relative << actionInfo.horizontalAnchor << actionInfo.verticalAnchor;
+  argument << actionInfo.scale << actionInfo.transform << actionInfo.adaptiveSync;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::ActionInfo& actionInfo) {
+  argument.beginStructure();
+  argument >> actionInfo.type >> actionInfo.serial >> actionInfo.on >> actionInfo.width >> actionInfo.height >> actionInfo.refreshRate;
+  argument >> actionInfo.x >> actionInfo.y >> actionInfo.relative >> actionInfo.horizontalAnchor >> actionInfo.verticalAnchor;
+  argument >> actionInfo.scale >> actionInfo.transform >> actionInfo.adaptiveSync;
+  argument.endStructure();
+  return argument;
+}
+
+QDBusArgument& operator<<(QDBusArgument& argument, const bd::Outputs::ApplyOutcome& outcome) {
+  argument.beginStructure();
+  argument << outcome.success << outcome.cancelled << outcome.durationMs;
+  argument << outcome.changedHeads << outcome.unchangedHeads << outcome.customModeFallbacks;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::ApplyOutcome& outcome) {
+  argument.beginStructure();
+  argument >> outcome.success >> outcome.cancelled >> outcome.durationMs;
+  argument >> outcome.changedHeads >> outcome.unchangedHeads >> outcome.customModeFallbacks;
+  argument.endStructure();
+  return argument;
+}
+
+QDBusArgument& operator<<(QDBusArgument& argument, const bd::Outputs::ConfigDiagnostic& diagnostic) {
+  argument.beginStructure();
+  argument << diagnostic.severity << diagnostic.location << diagnostic.message;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::ConfigDiagnostic& diagnostic) {
+  argument.beginStructure();
+  argument >> diagnostic.severity >> diagnostic.location >> diagnostic.message;
+  argument.endStructure();
+  return argument;
+}
+
+QDBusArgument& operator<<(QDBusArgument& argument, const bd::Outputs::HistoryEntryInfo& entry) {
+  argument.beginStructure();
+  argument << entry.index << entry.savedAt << entry.summary;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::HistoryEntryInfo& entry) {
+  argument.beginStructure();
+  argument >> entry.index >> entry.savedAt >> entry.summary;
+  argument.endStructure();
+  return argument;
+}
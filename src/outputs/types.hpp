@@ -1,9 +1,13 @@
 #pragma once
 
 #include <QDBusArgument>
+#include <QDBusObjectPath>
 #include <QMap>
+#include <QList>
 #include <QMetaType>
+#include <QRect>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
 
 namespace bd::Outputs {
@@ -22,14 +26,151 @@ namespace bd::Outputs {
   };
 
   typedef QMap<QString, OutputModeInfo> OutputModesMap;
+
+  // Everything a client needs to know about an output, marshalled as (sssssbbbiiiitdqussss(siitb)a{s(siitb)})
+  struct OutputSnapshotInfo {
+      QString        serial;
+      QString        name;
+      QString        make;
+      QString        model;
+      QString        description;
+      bool           enabled;
+      bool           builtIn;
+      bool           primary;
+      int            x;
+      int            y;
+      int            width;
+      int            height;
+      qulonglong     refreshRate;
+      double         scale;
+      quint16        transform;
+      uint           adaptiveSync;
+      QString        mirrorOf;
+      QString        relativeTo;
+      QString        horizontalAnchor;
+      QString        verticalAnchor;
+      OutputModeInfo currentMode;
+      OutputModesMap modes;
+  };
+
+  // The whole Outputs state in one message, marshalled as (a(...)(iiii)st)
+  struct OutputsSnapshot {
+      QList<OutputSnapshotInfo> outputs;
+      QRect                     globalRect;
+      QString                   primaryOutput;
+      qulonglong                generation;
+  };
+
+  // Calculated state of an output, marshalled as (sbiiiitdqubiiss)
+  struct OutputTargetStateInfo {
+      QString    serial;
+      bool       on;
+      int        x;
+      int        y;
+      int        width;
+      int        height;
+      qulonglong refreshRate;
+      double     scale;
+      quint16    transform;
+      uint       adaptiveSync;
+      bool       primary;
+      int        resultingWidth;
+      int        resultingHeight;
+      QString    horizontalAnchor;
+      QString    verticalAnchor;
+  };
+
+  // Outcome of a configuration calculation, marshalled as ((iiii)a(sbiiiitdqubiiss))
+  struct CalculationResultInfo {
+      QRect                        globalSpace;
+      QList<OutputTargetStateInfo> outputs;
+  };
+
+  // A single configuration action, marshalled as (ssbiitiisssdqu). Only the fields relevant to the type are meaningful.
+  struct ActionInfo {
+      QString    type;
+      QString    serial;
+      bool       on;
+      int        width;
+      int        height;
+      qulonglong refreshRate;
+      int        x;
+      int        y;
+      QString    relative;
+      QString    horizontalAnchor;
+      QString    verticalAnchor;
+      double     scale;
+      quint16    transform;
+      uint       adaptiveSync;
+  };
+
+  // What happened to an applied configuration, marshalled as (bbtasasas)
+  struct ApplyOutcome {
+      bool        success;
+      bool        cancelled;            // The compositor dropped it, as the output state changed since it was built
+      qulonglong  durationMs;           // From sending the configuration to the compositor answering it
+      QStringList changedHeads;
+      QStringList unchangedHeads;       // Sent as is, the target already matched the current state
+      QStringList customModeFallbacks;  // No advertised mode matched, a custom mode was requested instead
+  };
+
+  // A problem found while reading the display config, marshalled as (sss)
+  struct ConfigDiagnostic {
+      QString severity;  // "error" (the entry was skipped) or "warning" (it was used, possibly in part)
+      QString location;  // e.g. group[2].output[1]
+      QString message;
+  };
+
+  // An earlier version of the display config, marshalled as (uxs)
+  struct HistoryEntryInfo {
+      uint    index;    // Pass to Undo to go back to this version
+      qint64  savedAt;  // Unix time in seconds at which it became current
+      QString summary;  // Groups that differ from the version after it
+  };
+
+  // org.freedesktop.DBus.ObjectManager: object path -> interface -> properties
+  typedef QMap<QDBusObjectPath, NestedKvMap> ManagedObjectsMap;
 }
 
 Q_DECLARE_METATYPE(bd::Outputs::NestedKvMap);
 Q_DECLARE_METATYPE(bd::Outputs::OutputModeInfo);
 Q_DECLARE_METATYPE(bd::Outputs::OutputModesMap);
+Q_DECLARE_METATYPE(bd::Outputs::ManagedObjectsMap);
+Q_DECLARE_METATYPE(bd::Outputs::OutputSnapshotInfo);
+Q_DECLARE_METATYPE(bd::Outputs::OutputsSnapshot);
+Q_DECLARE_METATYPE(bd::Outputs::OutputTargetStateInfo);
+Q_DECLARE_METATYPE(bd::Outputs::CalculationResultInfo);
+Q_DECLARE_METATYPE(bd::Outputs::ActionInfo);
+Q_DECLARE_METATYPE(bd::Outputs::ApplyOutcome);
+Q_DECLARE_METATYPE(bd::Outputs::ConfigDiagnostic);
+Q_DECLARE_METATYPE(bd::Outputs::HistoryEntryInfo);
 
 QDBusArgument&       operator<<(QDBusArgument& argument, const bd::Outputs::OutputModeInfo& modeInfo);
 const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::OutputModeInfo& modeInfo);
 
 QDBusArgument&       operator<<(QDBusArgument& argument, const bd::Outputs::OutputModesMap& modesMap);
 const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::OutputModesMap& modesMap);
+
+QDBusArgument&       operator<<(QDBusArgument& argument, const bd::Outputs::OutputSnapshotInfo& outputInfo);
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::OutputSnapshotInfo& outputInfo);
+
+QDBusArgument&       operator<<(QDBusArgument& argument, const bd::Outputs::OutputsSnapshot& snapshot);
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::OutputsSnapshot& snapshot);
+
+QDBusArgument&       operator<<(QDBusArgument& argument, const bd::Outputs::OutputTargetStateInfo& stateInfo);
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::OutputTargetStateInfo& stateInfo);
+
+QDBusArgument&       operator<<(QDBusArgument& argument, const bd::Outputs::CalculationResultInfo& resultInfo);
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::CalculationResultInfo& resultInfo);
+
+QDBusArgument&       operator<<(QDBusArgument& argument, const bd::Outputs::ActionInfo& actionInfo);
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::ActionInfo& actionInfo);
+
+QDBusArgument&       operator<<(QDBusArgument& argument, const bd::Outputs::ApplyOutcome& outcome);
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::ApplyOutcome& outcome);
+
+QDBusArgument&       operator<<(QDBusArgument& argument, const bd::Outputs::ConfigDiagnostic& diagnostic);
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::ConfigDiagnostic& diagnostic);
+
+QDBusArgument&       operator<<(QDBusArgument& argument, const bd::Outputs::HistoryEntryInfo& entry);
+const QDBusArgument& operator>>(const QDBusArgument& argument, bd::Outputs::HistoryEntryInfo& entry);
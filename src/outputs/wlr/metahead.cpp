@@ -2,11 +2,17 @@
 #include <QtAlgorithms>
 #include <optional>
 #include <QDBusConnection>
+#include <QDBusMessage>
+#include <QMetaMethod>
+#include <QMetaProperty>
 #include <QSize>
 
 #include "metahead.hpp"
+#include "metamodetree.hpp"
 #include "head.hpp"
 #include "config/outputs/state.hpp"
+#include "dbus/ObjectManager.hpp"
+#include "dbus/PeerServer.hpp"
 #include "outputs/config/enums/anchors.hpp"
 #include "sys/SysInfo.hpp"
 
@@ -25,7 +31,11 @@ namespace bd::Outputs::Wlr {
               m_relative_output(""),
               m_horizontal_anchor(bd::Outputs::Config::HorizontalAnchor::None),
               m_vertical_anchor(bd::Outputs::Config::VerticalAnchor::None),
-              m_primary(false) {
+              m_primary(false),
+              m_mode_tree(new MetaModeTree(this)),
+              m_generation(0),
+              m_modes_cache_valid(false) {
+        connectPropertyNotifiers();
     }
 
     MetaHead::~MetaHead() {
@@ -134,11 +144,15 @@ namespace bd::Outputs::Wlr {
     }
 
     bd::Outputs::OutputModesMap MetaHead::modes() const {
+        if (m_modes_cache_valid) return m_modes_cache;
+
         bd::Outputs::OutputModesMap modes;
         for (const auto& mode_ptr: m_output_modes) {
             if (!mode_ptr) continue;
             modes.insert(mode_ptr->id(), mode_ptr->toDBusStruct());
         }
+        m_modes_cache = modes;
+        m_modes_cache_valid = true;
         return modes;
     }
 
@@ -166,6 +180,10 @@ namespace bd::Outputs::Wlr {
         return m_enabled;
     }
 
+    qulonglong MetaHead::generation() const {
+        return m_generation;
+    }
+
     int MetaHead::width() const {
         auto mode = m_current_mode;
         if (mode) return mode->getSize().value_or(QSize(0, 0)).width();
@@ -224,6 +242,33 @@ namespace bd::Outputs::Wlr {
         return m_relative_output;
     }
 
+    bd::Outputs::OutputSnapshotInfo MetaHead::toDBusStruct() const {
+        bd::Outputs::OutputSnapshotInfo info;
+        info.serial = serial();
+        info.name = m_name;
+        info.make = m_make;
+        info.model = m_model;
+        info.description = m_description;
+        info.enabled = m_enabled;
+        info.builtIn = const_cast<MetaHead*>(this)->builtIn();
+        info.primary = m_primary;
+        info.x = x();
+        info.y = y();
+        info.width = width();
+        info.height = height();
+        info.refreshRate = refreshRate();
+        info.scale = m_scale;
+        info.transform = transform();
+        info.adaptiveSync = adaptiveSync();
+        info.mirrorOf = mirrorOf();
+        info.relativeTo = m_relative_output;
+        info.horizontalAnchor = horizontalAnchor();
+        info.verticalAnchor = verticalAnchor();
+        info.currentMode = currentMode();
+        info.modes = modes();
+        return info;
+    }
+
     // Setters
 
     void MetaHead::setHead(::zwlr_output_head_v1 *wlr_head) {
@@ -259,6 +304,8 @@ namespace bd::Outputs::Wlr {
         m_position.setX(position.x());
         m_position.setY(position.y());
         emit positionChanged(m_position);
+        emit xChanged(m_position.x());
+        emit yChanged(m_position.y());
         emit stateChanged();
     }
 
@@ -284,6 +331,8 @@ namespace bd::Outputs::Wlr {
         auto output_mode = new bd::Outputs::Wlr::MetaMode(this, mode);
         auto shared_ptr = QSharedPointer<bd::Outputs::Wlr::MetaMode>(output_mode);
 
+        connect(output_mode, &bd::Outputs::Wlr::MetaMode::modeFinished, this, [this, output_mode]() { removeMode(output_mode); });
+
         connect(output_mode, &bd::Outputs::Wlr::MetaMode::done, this, [this, output_mode, shared_ptr]() {
             // Check if this already exists
             qDebug() << "Done triggered for mode" << output_mode->id() << "on head" << getIdentifier();
@@ -299,10 +348,12 @@ namespace bd::Outputs::Wlr {
                 if (existing_mode->isSameAs(output_mode)) {
                     qDebug() << "Found an output mode (ID: " << existing_mode->id() << ") that matches one we already have, deleting the old one.";
                     found_matching_mode = true;
-                    m_output_modes.removeOne(mode_ptr);
-
                     matching_mode_is_current = (m_current_mode == mode_ptr);
 
+                    // Free up the object path for the replacement
+                    existing_mode->unregisterDbusService();
+                    m_output_modes.removeOne(mode_ptr);
+
                     break;
                 }
             }
@@ -313,6 +364,12 @@ namespace bd::Outputs::Wlr {
                      << " and refresh: " << static_cast<qulonglong>(output_mode->getRefresh().value_or(0));
 
             m_output_modes.append(shared_ptr);
+            m_modes_cache_valid = false;
+            m_added_modes.insert(output_mode->id(), output_mode->toDBusStruct());
+            m_removed_modes.removeAll(output_mode->id());
+
+            // Modes announced after the output was exported need exporting themselves
+            if (isDbusRegistered()) output_mode->registerDbusService();
 
             emit modesChanged();
 
@@ -354,7 +411,6 @@ namespace bd::Outputs::Wlr {
                          << refresh;
                 m_current_mode = output_mode_ptr; // Set m_current_mode to same QSharedPointer as iterated output mode
 
-                emit modesChanged();
                 emit widthChanged(outputModeSize.width());
                 emit heightChanged(outputModeSize.height());
                 emit refreshRateChanged(refresh);
@@ -365,6 +421,32 @@ namespace bd::Outputs::Wlr {
         }
     }
 
+    void MetaHead::removeMode(bd::Outputs::Wlr::MetaMode *mode) {
+        for (const auto &mode_ptr: m_output_modes) {
+            if (mode_ptr.data() != mode) continue;
+
+            qDebug() << "Removing finished output mode (ID: " << mode->id() << ") from head:" << getIdentifier();
+            auto id = mode->id();
+            mode->unregisterDbusService();
+
+            if (m_current_mode == mode_ptr) {
+                m_current_mode.clear();
+                emit currentModeChanged(currentMode());
+            }
+
+            // Keep the mode alive until we are done with it, removing it may drop the last reference
+            auto keep_alive = mode_ptr;
+            m_output_modes.removeOne(keep_alive);
+            m_modes_cache_valid = false;
+            m_added_modes.remove(id);
+            if (!m_removed_modes.contains(id)) m_removed_modes.append(id);
+
+            emit modesChanged();
+            emit stateChanged();
+            return;
+        }
+    }
+
     void MetaHead::headDisconnected() {
         qDebug() << "Head disconnected for output: " << getIdentifier();
         m_head.clear();
@@ -413,6 +495,8 @@ namespace bd::Outputs::Wlr {
                 m_position = value.toPoint();
                 qDebug() << "Setting position on head" << getIdentifier() << "to" << m_position.x() << m_position.y();
                 emit positionChanged(m_position);
+                emit xChanged(m_position.x());
+                emit yChanged(m_position.y());
                 emit stateChanged();
                 break;
             case MetaHeadProperty::Property::Scale:
@@ -443,9 +527,9 @@ namespace bd::Outputs::Wlr {
         // If the property was not changed, do nothing
         if (!changed) return;
 
-        // If we are in shim mode, immediately save the state whenever the head changes
+        // If we are in shim mode, record the state whenever the head changes
         if (SysInfo::instance().isShimMode()) {
-            bd::Config::Outputs::State::instance().save();
+            bd::Config::Outputs::State::instance().recordRuntimeState();
         }
     }
 
@@ -460,8 +544,10 @@ namespace bd::Outputs::Wlr {
     }
 
     void MetaHead::setRelativeOutput(const QString &relative) {
+        if (m_relative_output == relative) return;
         m_relative_output = relative;
         qDebug() << "Relative output set for head" << getIdentifier() << "relative:" << m_relative_output;
+        emit relativeToChanged(m_relative_output);
     }
 
     void MetaHead::setHorizontalAnchoring(bd::Outputs::Config::HorizontalAnchor::Type horizontal) {
@@ -469,6 +555,7 @@ namespace bd::Outputs::Wlr {
         m_horizontal_anchor = horizontal;
         qDebug() << "Horizontal anchoring set for head" << getIdentifier()
                  << "h:" << bd::Outputs::Config::HorizontalAnchor::toString(m_horizontal_anchor);
+        emit horizontalAnchorChanged(horizontalAnchor());
     }
 
 
@@ -477,21 +564,111 @@ namespace bd::Outputs::Wlr {
         m_vertical_anchor = vertical;
         qDebug() << "Vertical anchoring set for head" << getIdentifier()
                  << "v:" << bd::Outputs::Config::VerticalAnchor::toString(m_vertical_anchor);
+        emit verticalAnchorChanged(verticalAnchor());
     }
 
     // D-Bus registration
     void MetaHead::registerDbusService() {
         QString objectPath = QString("/org/buddiesofbudgie/Services/Outputs/%1").arg(getIdentifier());
         qInfo() << "Registering DBus service for output" << getIdentifier() << "at path" << objectPath;
-        if (!QDBusConnection::sessionBus().registerObject(objectPath, this, QDBusConnection::ExportAllContents)) {
+        if (!bd::PeerServer::instance().registerObject(objectPath, this)) {
             qCritical() << "Failed to register DBus object at path" << objectPath;
             return;
         }
 
-        // Register all modes for this output
+        // Clients read the initial values when they discover the object, nothing pending needs announcing
+        m_dbus_path = objectPath;
+        m_changed_properties.clear();
+        bd::ObjectManager::instance().objectAdded(objectPath, this);
+
+        // Modes are served by one virtual object rather than an exported object each
+        if (!m_mode_tree->registerDbusService(objectPath)) return;
+
+        // Announce all modes for this output
         for (const auto& mode : m_output_modes) {
             if (!mode) continue;
             mode->registerDbusService();
         }
     }
+
+    void MetaHead::unregisterDbusService() {
+        if (m_dbus_path.isEmpty()) return;
+        qInfo() << "Unregistering DBus service for output" << getIdentifier() << "at path" << m_dbus_path;
+
+        for (const auto& mode : m_output_modes) {
+            if (!mode) continue;
+            mode->unregisterDbusService();
+        }
+        m_mode_tree->unregisterDbusService();
+
+        bd::PeerServer::instance().unregisterObject(m_dbus_path, QDBusConnection::UnregisterTree);
+        bd::ObjectManager::instance().objectRemoved(m_dbus_path);
+        m_dbus_path.clear();
+    }
+
+    bool MetaHead::isDbusRegistered() const {
+        return !m_dbus_path.isEmpty();
+    }
+
+    // D-Bus PropertiesChanged batching
+
+    void MetaHead::connectPropertyNotifiers() {
+        // Map every NOTIFY signal of our properties onto a single slot, so any property change gets recorded without each setter having to know about D-Bus
+        const auto meta = &MetaHead::staticMetaObject;
+        const auto slot = meta->method(meta->indexOfSlot("trackPropertyChange()"));
+
+        for (int i = meta->propertyOffset(); i < meta->propertyCount(); ++i) {
+            auto property = meta->property(i);
+            if (!property.hasNotifySignal()) continue;
+            m_notify_signal_properties.insert(property.notifySignalIndex(), QByteArray(property.name()));
+            connect(this, property.notifySignal(), this, slot);
+        }
+    }
+
+    void MetaHead::trackPropertyChange() {
+        auto name = m_notify_signal_properties.value(senderSignalIndex());
+        if (name.isEmpty()) return;
+        m_changed_properties.insert(name);
+
+        // generation is itself a notified property, don't count its own change
+        if (name == "generation") return;
+        m_generation++;
+        emit generationChanged(m_generation);
+    }
+
+    void MetaHead::flushPropertiesChanged() {
+        // Not exported yet, the values will be read on discovery instead
+        if (m_dbus_path.isEmpty()) {
+            m_changed_properties.clear();
+            m_added_modes.clear();
+            m_removed_modes.clear();
+            return;
+        }
+
+        // Mode deltas go out first, so clients holding a modes map can patch it rather than fetching it again
+        if (!m_removed_modes.isEmpty()) emit ModesRemoved(m_removed_modes);
+        if (!m_added_modes.isEmpty()) emit ModesAdded(m_added_modes);
+        m_removed_modes.clear();
+        m_added_modes.clear();
+
+        if (m_changed_properties.isEmpty()) return;
+
+        QVariantMap changed;
+        QStringList invalidated;
+        for (const auto& name : std::as_const(m_changed_properties)) {
+            // The whole modes map is too large to send on every change, ModesAdded/ModesRemoved carry the delta instead
+            if (name == "modes") {
+                invalidated.append(QString::fromLatin1(name));
+                continue;
+            }
+            changed.insert(QString::fromLatin1(name), property(name.constData()));
+        }
+        m_changed_properties.clear();
+
+        qDebug() << "Emitting PropertiesChanged for output" << getIdentifier() << "with properties:" << changed.keys() << "invalidated:" << invalidated;
+
+        auto signal = QDBusMessage::createSignal(m_dbus_path, "org.freedesktop.DBus.Properties", "PropertiesChanged");
+        signal << QString("org.buddiesofbudgie.Services.Output") << changed << invalidated;
+        bd::PeerServer::instance().send(signal);
+    }
 }
@@ -5,6 +5,7 @@
 #include <QDBusContext>
 #include <QObject>
 #include <QPoint>
+#include <QSet>
 #include <QSharedPointer>
 #include <optional>
 
@@ -15,6 +16,7 @@
 #include "outputs/types.hpp"
 
 namespace bd::Outputs::Wlr {
+    class MetaModeTree;
 
     class MetaHead : public QObject, protected QDBusContext {
     Q_OBJECT
@@ -24,6 +26,7 @@ namespace bd::Outputs::Wlr {
     Q_PROPERTY(bd::Outputs::OutputModeInfo currentMode READ currentMode NOTIFY currentModeChanged)
     Q_PROPERTY(QString description READ description NOTIFY descriptionChanged)
     Q_PROPERTY(bool enabled READ enabled NOTIFY enabledChanged)
+    Q_PROPERTY(qulonglong generation READ generation NOTIFY generationChanged)
     Q_PROPERTY(int height READ height NOTIFY heightChanged)
     Q_PROPERTY(QString horizontalAnchor READ horizontalAnchor NOTIFY horizontalAnchorChanged)
     Q_PROPERTY(QString make READ make NOTIFY makeChanged)
@@ -62,6 +65,8 @@ namespace bd::Outputs::Wlr {
         bd::Outputs::OutputModeInfo currentMode() const;
         QString description() const;
         bool enabled() const;
+        // Bumped on every property change, so clients can tell whether anything changed since they last looked
+        qulonglong generation() const;
         int height() const;
         QString horizontalAnchor() const;
         QString make() const;
@@ -81,6 +86,8 @@ namespace bd::Outputs::Wlr {
         int y() const;
         QString verticalAnchor() const;
 
+        bd::Outputs::OutputSnapshotInfo toDBusStruct() const;
+
         // Internal getters (used by Q_PROPERTY getters or for special return types)
         QString getIdentifier(); // Used by serial() Q_PROPERTY getter
         QPoint getPosition(); // Returns QPoint (x()/y() return int)
@@ -107,6 +114,12 @@ namespace bd::Outputs::Wlr {
 
         // D-Bus registration
         void registerDbusService();
+        void unregisterDbusService();
+        bool isDbusRegistered() const;
+
+        // Emits a single org.freedesktop.DBus.Properties.PropertiesChanged for every property changed since the last flush.
+        // Called once per output manager done event so clients see one signal per output per commit cycle.
+        void flushPropertiesChanged();
 
     Q_SIGNALS:
 
@@ -119,12 +132,16 @@ namespace bd::Outputs::Wlr {
         void currentModeChanged(const bd::Outputs::OutputModeInfo &currentMode);
         void descriptionChanged(const QString &description);
         void enabledChanged(bool enabled);
+        void generationChanged(qulonglong generation);
         void heightChanged(int height);
         void horizontalAnchorChanged(const QString &horizontalAnchor);
         void makeChanged(const QString &make);
         void mirrorOfChanged(const QString &mirrorOf);
         void modelChanged(const QString &model);
         void modesChanged();
+        // Deltas of the modes property, emitted once per commit cycle alongside PropertiesChanged
+        void ModesAdded(const bd::Outputs::OutputModesMap &modes);
+        void ModesRemoved(const QStringList &ids);
         void nameChanged(const QString &name);
         void positionChanged(const QPoint &position);
         void primaryChanged(bool primary);
@@ -144,11 +161,17 @@ namespace bd::Outputs::Wlr {
 
         void currentZwlrModeChanged(::zwlr_output_mode_v1 *mode);
 
+        void removeMode(bd::Outputs::Wlr::MetaMode *mode);
+
         void headDisconnected();
 
         void setProperty(MetaHeadProperty::Property property, const QVariant &value);
 
+        void trackPropertyChange();
+
     private:
+        void connectPropertyNotifiers();
+
         KWayland::Client::Registry *m_registry;
         QSharedPointer<bd::Outputs::Wlr::Head> m_head;
         QString m_make;
@@ -157,6 +180,9 @@ namespace bd::Outputs::Wlr {
         QString m_description;
         QString m_identifier;
         QList<QSharedPointer<bd::Outputs::Wlr::MetaMode>> m_output_modes;
+        // modes() is rebuilt only once the mode set changed
+        mutable bd::Outputs::OutputModesMap m_modes_cache;
+        mutable bool m_modes_cache_valid;
         QString m_serial;
         QSharedPointer<bd::Outputs::Wlr::MetaMode> m_current_mode;
 
@@ -174,5 +200,17 @@ namespace bd::Outputs::Wlr {
         bd::Outputs::Config::HorizontalAnchor::Type m_horizontal_anchor;
         bd::Outputs::Config::VerticalAnchor::Type m_vertical_anchor;
         bool m_primary;
+
+        // Serves the mode objects below our path
+        MetaModeTree *m_mode_tree;
+
+        qulonglong m_generation;
+
+        // D-Bus PropertiesChanged batching
+        QString m_dbus_path;
+        QHash<int, QByteArray> m_notify_signal_properties;
+        QSet<QByteArray> m_changed_properties;
+        bd::Outputs::OutputModesMap m_added_modes;
+        QStringList m_removed_modes;
     };
 }
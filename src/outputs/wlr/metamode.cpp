@@ -1,6 +1,6 @@
-#include <QDBusConnection>
 #include <QPointer>
 
+#include "dbus/ObjectManager.hpp"
 #include "metahead.hpp"
 #include "metamode.hpp"
 
@@ -105,10 +105,17 @@ namespace bd::Outputs::Wlr {
         if (!head) return;
         auto outputId = head->getIdentifier();
         QString objectPath = QString("/org/buddiesofbudgie/Services/Outputs/%1/Modes/%2").arg(outputId).arg(m_id);
-        qDebug() << "Registering DBus service for mode" << m_id << "at path" << objectPath;
-        if (!QDBusConnection::sessionBus().registerObject(objectPath, this, QDBusConnection::ExportAllContents)) {
-            qWarning() << "Failed to register DBus object at path" << objectPath;
-        }
+        // The path itself is served by the head's MetaModeTree, so all that is left is announcing the mode
+        qDebug() << "Announcing DBus service for mode" << m_id << "at path" << objectPath;
+        m_dbus_path = objectPath;
+        bd::ObjectManager::instance().objectAdded(objectPath, this);
+    }
+
+    void MetaMode::unregisterDbusService() {
+        if (m_dbus_path.isEmpty()) return;
+        qDebug() << "Withdrawing DBus service for mode" << m_id << "at path" << m_dbus_path;
+        bd::ObjectManager::instance().objectRemoved(m_dbus_path);
+        m_dbus_path.clear();
     }
 
     // Setters
@@ -126,6 +133,8 @@ namespace bd::Outputs::Wlr {
 
         connect(mode, &Mode::propertyChanged,
                 this, &MetaMode::setProperty);
+        // Queued, as handling it drops the Mode while it is still inside its own finished event
+        connect(mode, &Mode::modeFinished, this, &MetaMode::modeDisconnected, Qt::QueuedConnection);
     }
 
     void MetaMode::unsetMode() {
@@ -151,6 +160,7 @@ namespace bd::Outputs::Wlr {
         unsetMode();
         emit availabilityChanged(false);
         m_is_available = std::make_optional<bool>(false);
+        emit modeFinished();
     }
 
     void MetaMode::setPreferred(bool preferred) {
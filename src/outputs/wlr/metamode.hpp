@@ -52,6 +52,8 @@ namespace bd::Outputs::Wlr {
 
         void registerDbusService();
 
+        void unregisterDbusService();
+
         void setMode(::zwlr_output_mode_v1 *wlr_mode);
 
         void setPreferred(bool preferred);
@@ -61,6 +63,7 @@ namespace bd::Outputs::Wlr {
     Q_SIGNALS:
         void availabilityChanged(bool available);
         void done();
+        void modeFinished();
         void preferredChanged(bool preferred);
         void refreshRateChanged(qulonglong refreshRate);
         void sizeChanged(QSize size);
@@ -78,5 +81,6 @@ namespace bd::Outputs::Wlr {
         qulonglong m_refresh;
         std::optional<bool> m_preferred;
         std::optional<bool> m_is_available;
+        QString m_dbus_path;
     };
 }
@@ -0,0 +1,174 @@
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusVariant>
+
+#include "dbus/ObjectManager.hpp"
+#include "dbus/PeerServer.hpp"
+#include "metahead.hpp"
+#include "metamode.hpp"
+#include "metamodetree.hpp"
+
+#define OUTPUT_MODE_INTERFACE "org.buddiesofbudgie.Services.OutputMode"
+#define PROPERTIES_INTERFACE "org.freedesktop.DBus.Properties"
+
+namespace bd::Outputs::Wlr {
+    namespace {
+        // Mirrors the properties of DisplaySchema.OutputMode.xml
+        const QString modeInterfaceXml = QStringLiteral(
+            "  <interface name=\"" OUTPUT_MODE_INTERFACE "\">\n"
+            "    <property name=\"available\" type=\"b\" access=\"read\"/>\n"
+            "    <property name=\"current\" type=\"b\" access=\"read\"/>\n"
+            "    <property name=\"height\" type=\"i\" access=\"read\"/>\n"
+            "    <property name=\"id\" type=\"s\" access=\"read\"/>\n"
+            "    <property name=\"preferred\" type=\"b\" access=\"read\"/>\n"
+            "    <property name=\"refreshRate\" type=\"t\" access=\"read\"/>\n"
+            "    <property name=\"width\" type=\"i\" access=\"read\"/>\n"
+            "  </interface>\n"
+            "  <interface name=\"" PROPERTIES_INTERFACE "\">\n"
+            "    <method name=\"Get\">\n"
+            "      <arg name=\"interface_name\" type=\"s\" direction=\"in\"/>\n"
+            "      <arg name=\"property_name\" type=\"s\" direction=\"in\"/>\n"
+            "      <arg name=\"value\" type=\"v\" direction=\"out\"/>\n"
+            "    </method>\n"
+            "    <method name=\"GetAll\">\n"
+            "      <arg name=\"interface_name\" type=\"s\" direction=\"in\"/>\n"
+            "      <arg name=\"values\" type=\"a{sv}\" direction=\"out\"/>\n"
+            "      <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"QVariantMap\"/>\n"
+            "    </method>\n"
+            "    <signal name=\"PropertiesChanged\">\n"
+            "      <arg name=\"interface_name\" type=\"s\"/>\n"
+            "      <arg name=\"changed_properties\" type=\"a{sv}\"/>\n"
+            "      <arg name=\"invalidated_properties\" type=\"as\"/>\n"
+            "      <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"QVariantMap\"/>\n"
+            "    </signal>\n"
+            "  </interface>\n");
+    }
+
+    MetaModeTree::MetaModeTree(MetaHead *head) : QDBusVirtualObject(head), m_head(head), m_path(QString()), m_current_id(QString()) {
+        connect(m_head, &MetaHead::modesChanged, this, &MetaModeTree::onModesChanged);
+        connect(m_head, &MetaHead::currentModeChanged, this, &MetaModeTree::onCurrentModeChanged);
+    }
+
+    bool MetaModeTree::registerDbusService(const QString &headPath) {
+        auto objectPath = QString("%1/Modes").arg(headPath);
+        if (!bd::PeerServer::instance().registerVirtualObject(objectPath, this)) {
+            qWarning() << "Failed to register DBus mode tree at path" << objectPath;
+            return false;
+        }
+        m_path = objectPath;
+
+        auto current = m_head->getCurrentMode();
+        m_current_id = current ? current->id() : QString();
+        return true;
+    }
+
+    void MetaModeTree::unregisterDbusService() {
+        if (m_path.isEmpty()) return;
+        bd::PeerServer::instance().unregisterObject(m_path, QDBusConnection::UnregisterTree);
+        m_path.clear();
+    }
+
+    QString MetaModeTree::path() const {
+        return m_path;
+    }
+
+    QString MetaModeTree::modePath(const QString &id) const {
+        if (m_path.isEmpty() || id.isEmpty()) return QString();
+        return QString("%1/%2").arg(m_path, id);
+    }
+
+    void MetaModeTree::onModesChanged() {
+        // Modes come and go, connecting again to the ones we already follow is a no-op
+        for (const auto &mode : m_head->getModes()) {
+            if (!mode) continue;
+            connect(mode.data(), &MetaMode::availabilityChanged, this, &MetaModeTree::onAvailabilityChanged, Qt::UniqueConnection);
+        }
+    }
+
+    void MetaModeTree::onAvailabilityChanged(bool available) {
+        auto mode = qobject_cast<MetaMode*>(sender());
+        if (!mode) return;
+        sendPropertiesChanged(mode->id(), QVariantMap {{"available", available}});
+    }
+
+    void MetaModeTree::onCurrentModeChanged() {
+        auto current = m_head->getCurrentMode();
+        auto id = current ? current->id() : QString();
+        if (id == m_current_id) return;
+
+        // The mode that was current is no longer, unless it went away along with its path
+        auto previous = m_current_id;
+        m_current_id = id;
+        if (modeForPath(modePath(previous))) sendPropertiesChanged(previous, QVariantMap {{"current", false}});
+        sendPropertiesChanged(id, QVariantMap {{"current", true}});
+    }
+
+    void MetaModeTree::sendPropertiesChanged(const QString &id, const QVariantMap &changed) {
+        auto path = modePath(id);
+        if (path.isEmpty()) return;
+
+        auto signal = QDBusMessage::createSignal(path, PROPERTIES_INTERFACE, "PropertiesChanged");
+        signal << QString(OUTPUT_MODE_INTERFACE) << changed << QStringList();
+        bd::PeerServer::instance().send(signal);
+    }
+
+    MetaMode* MetaModeTree::modeForPath(const QString &path) const {
+        if (m_path.isEmpty() || !path.startsWith(m_path + '/')) return nullptr;
+        auto id = path.mid(m_path.size() + 1);
+
+        for (const auto &mode : m_head->getModes()) {
+            if (mode && mode->id() == id) return mode.data();
+        }
+        return nullptr;
+    }
+
+    QString MetaModeTree::introspect(const QString &path) const {
+        // The Modes node itself only lists its children
+        if (path == m_path) {
+            QString nodes;
+            for (const auto &mode : m_head->getModes()) {
+                if (!mode || mode->id().isEmpty()) continue;
+                nodes += QString("  <node name=\"%1\"/>\n").arg(mode->id());
+            }
+            return nodes;
+        }
+
+        if (!modeForPath(path)) return QString();
+        return modeInterfaceXml;
+    }
+
+    bool MetaModeTree::handleMessage(const QDBusMessage &message, const QDBusConnection &connection) {
+        // Introspection is answered by QtDBus through introspect()
+        if (message.interface() != PROPERTIES_INTERFACE) return false;
+
+        auto mode = modeForPath(message.path());
+        if (!mode) {
+            connection.send(message.createErrorReply(QDBusError::UnknownObject, QString("No mode at %1").arg(message.path())));
+            return true;
+        }
+
+        auto arguments = message.arguments();
+        auto interface = arguments.value(0).toString();
+        if (!interface.isEmpty() && interface != OUTPUT_MODE_INTERFACE) {
+            connection.send(message.createErrorReply(QDBusError::UnknownInterface, QString("Unknown interface %1").arg(interface)));
+            return true;
+        }
+
+        auto properties = bd::ObjectManager::propertiesOf(mode);
+        if (message.member() == "GetAll") {
+            connection.send(message.createReply(QVariant::fromValue(properties)));
+        } else if (message.member() == "Get") {
+            auto name = arguments.value(1).toString();
+            if (!properties.contains(name)) {
+                connection.send(message.createErrorReply(QDBusError::UnknownProperty, QString("Unknown property %1").arg(name)));
+            } else {
+                connection.send(message.createReply(QVariant::fromValue(QDBusVariant(properties.value(name)))));
+            }
+        } else if (message.member() == "Set") {
+            connection.send(message.createErrorReply(QDBusError::PropertyReadOnly, "Mode properties are read-only"));
+        } else {
+            connection.send(message.createErrorReply(QDBusError::UnknownMethod, QString("Unknown method %1").arg(message.member())));
+        }
+        return true;
+    }
+}
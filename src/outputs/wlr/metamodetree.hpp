@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QDBusVirtualObject>
+#include <QObject>
+#include <QString>
+
+namespace bd::Outputs::Wlr {
+    class MetaHead;
+    class MetaMode;
+
+    // Serves every mode of a head from a single virtual object registered at <head path>/Modes, rather than exporting one
+    // QObject per mode. Mode paths (<head path>/Modes/<id>) are resolved on demand, so the number of registered objects
+    // stays constant no matter how many modes an output advertises.
+    //
+    // Modes keep their size and refresh once announced, but available and current change. Those are announced through
+    // org.freedesktop.DBus.Properties.PropertiesChanged on the mode path, sent by hand as there is no QObject to relay it.
+    class MetaModeTree : public QDBusVirtualObject {
+    Q_OBJECT
+
+    public:
+        explicit MetaModeTree(MetaHead *head);
+        ~MetaModeTree() override = default;
+
+        bool registerDbusService(const QString &headPath);
+        void unregisterDbusService();
+
+        QString path() const;
+        QString modePath(const QString &id) const;
+
+        QString introspect(const QString &path) const override;
+        bool handleMessage(const QDBusMessage &message, const QDBusConnection &connection) override;
+
+    private Q_SLOTS:
+        void onModesChanged();
+        void onAvailabilityChanged(bool available);
+        void onCurrentModeChanged();
+
+    private:
+        MetaMode* modeForPath(const QString &path) const;
+        void sendPropertiesChanged(const QString &id, const QVariantMap &changed);
+
+        MetaHead *m_head;
+        QString m_path;
+        // Id of the mode we last announced as current
+        QString m_current_id;
+    };
+}
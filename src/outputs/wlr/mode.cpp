@@ -24,4 +24,9 @@ namespace bd::Outputs::Wlr {
   void Mode::zwlr_output_mode_v1_preferred() {
     emit propertyChanged(MetaModeProperty::Property::Preferred, QVariant::fromValue(true));
   }
+
+  void Mode::zwlr_output_mode_v1_finished() {
+    qDebug() << "Mode finished";
+    emit modeFinished();
+  }
 }
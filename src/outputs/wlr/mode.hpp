@@ -23,7 +23,7 @@ namespace bd::Outputs::Wlr {
       void zwlr_output_mode_v1_size(int32_t width, int32_t height) override;
       void zwlr_output_mode_v1_refresh(int32_t refresh) override;
       void zwlr_output_mode_v1_preferred() override;
-//      void zwlr_output_mode_v1_finished() override;
+      void zwlr_output_mode_v1_finished() override;
 
   };
 }
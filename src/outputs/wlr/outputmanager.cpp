@@ -35,13 +35,24 @@ namespace bd::Outputs::Wlr {
             }
             m_inhead=true;
             qDebug() << "Head available for output: " << head->getIdentifier();
-            auto sharedHead = QSharedPointer<bd::Outputs::Wlr::MetaHead>(head);
+            // Use deleteLater as the head may drop its last reference while still handling its own finished event
+            auto sharedHead = QSharedPointer<bd::Outputs::Wlr::MetaHead>(head, &QObject::deleteLater);
             m_heads.append(sharedHead);
             emit headAdded(sharedHead);
 
             m_inhead=false;
         });
 
+        connect(head, &bd::Outputs::Wlr::MetaHead::headNoLongerAvailable, this, [this, head]() {
+            for (int i = 0; i < m_heads.size(); ++i) {
+                if (m_heads.at(i).data() != head) continue;
+                qDebug() << "Head no longer available for output: " << head->getIdentifier();
+                auto sharedHead = m_heads.takeAt(i);
+                emit headRemoved(sharedHead);
+                return;
+            }
+        });
+
         head->setHead(wlr_head);
     }
 